@@ -0,0 +1,250 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * A cache of t24p values and SFP deltas, keyed by what they depend on:
+ * the SFP part number, the gateware and the temperature. On link-up a
+ * matching entry is used right away instead of scanning the phase
+ * shifter, and it is then checked in the background.
+ *
+ * The check can't move the shifter (the servo owns it by then), so it
+ * samples the timestamper flip bit wherever the servo put the phase,
+ * once a second, and compares with what the cached t24p predicts. Too
+ * many disagreements drop the entry, so the next link-up calibrates.
+ */
+#include <string.h>
+#include <wrc.h>
+#include <task.h>
+#include <w1.h>
+
+#include "board.h"
+#include "endpoint.h"
+#include "softpll_ng.h"
+#include "eeprom.h"
+#include "sfp.h"
+#include "rxts_calibrator.h"
+
+#define CC_TEMP_NONE	(-128)	/* no sensor: a bucket of its own */
+#define CC_TEMP_SHIFT	18	/* 16.16 fixed point: 4 degrees per bucket */
+
+#define CC_CHECK_GUARD	(REF_CLOCK_PERIOD_PS / 8)
+#define CC_CHECK_SAMPLES 16
+#define CC_CHECK_MAX_BAD 4
+
+static struct s_calcache cc_slots[CAL_CACHE_SLOTS];
+static struct s_calcache cc_key;	/* for the current link */
+
+static struct {
+	int slot;		/* entry being checked, or -1 */
+	int good, bad;
+	uint32_t next;
+} cc_chk = {.slot = -1};
+
+static uint8_t cc_sum(struct s_calcache *e)
+{
+	uint8_t *ptr = (uint8_t *)e, sum = 0;
+	int i;
+
+	for (i = 0; i < sizeof(*e) - 1; i++)
+		sum += ptr[i];
+	return ~sum; /* so all-zero and all-one slots are invalid */
+}
+
+static int cc_valid(int slot)
+{
+	return cc_slots[slot].chksum == cc_sum(cc_slots + slot);
+}
+
+void calib_cache_init(void)
+{
+	int i;
+
+	for (i = 0; i < CAL_CACHE_SLOTS; i++)
+		if (eeprom_calcache(i, cc_slots + i, 0) < 0)
+			memset(cc_slots + i, 0, sizeof(cc_slots[i]));
+}
+
+/*
+ * Fill cc_key with the current SFP, gateware and temperature. Fails if
+ * the SFP can't be read or a sensor has no reading yet: such a key
+ * must neither match nor be stored.
+ */
+static int cc_make_key(void)
+{
+	int32_t temp;
+
+	memset(&cc_key, 0, sizeof(cc_key));
+	if (sfp_present() && sfp_read_part_id(cc_key.pn) < 0)
+		return -1;
+	cc_key.gw = sdb_gateware_id();
+
+	temp = w1_temp_get(0, NULL);
+	if (temp != W1_TEMP_NONE)
+		cc_key.temp = temp >> CC_TEMP_SHIFT;
+	else if (w1_temp_count())
+		return -1;
+	else
+		cc_key.temp = CC_TEMP_NONE;
+	return 0;
+}
+
+static int cc_match(int slot)
+{
+	struct s_calcache *e = cc_slots + slot;
+
+	return cc_valid(slot) && e->gw == cc_key.gw && e->temp == cc_key.temp
+		&& !memcmp(e->pn, cc_key.pn, SFP_PN_LEN);
+}
+
+/*
+ * Called at link-up, before calibrating: returns 1 and sets the t24p
+ * value and the SFP deltas if we have them, 0 otherwise.
+ */
+int calib_cache_lookup(uint32_t *t24p)
+{
+	struct s_calcache *e;
+	int i;
+
+	cc_chk.slot = -1;
+	if (cc_make_key() < 0)
+		return 0;
+	for (i = 0; i < CAL_CACHE_SLOTS; i++)
+		if (cc_match(i))
+			break;
+	if (i == CAL_CACHE_SLOTS)
+		return 0;
+
+	e = cc_slots + i;
+	*t24p = e->t24p;
+	sfp_deltaTx = e->dTx;
+	sfp_deltaRx = e->dRx;
+	sfp_alpha = e->alpha;
+
+	cc_chk.slot = i;
+	cc_chk.good = cc_chk.bad = 0;
+	cc_chk.next = timer_get_tics() + TICS_PER_SECOND;
+	return 1;
+}
+
+/* Called after a full calibration: replace the same key or the oldest */
+void calib_cache_store(uint32_t t24p)
+{
+	int i, slot = -1, old = -1;
+	uint16_t stamp = 0;
+
+	cc_chk.slot = -1;
+	if (cc_make_key() < 0)
+		return;
+	for (i = 0; i < CAL_CACHE_SLOTS; i++) {
+		if (!cc_valid(i)) {
+			if (slot < 0)
+				slot = i;
+			continue;
+		}
+		if (cc_match(i))
+			slot = i;
+		if (old < 0 || cc_slots[i].stamp < cc_slots[old].stamp)
+			old = i;
+		if (cc_slots[i].stamp >= stamp)
+			stamp = cc_slots[i].stamp + 1;
+	}
+	if (slot < 0)
+		slot = old;
+
+	cc_key.stamp = stamp;
+	cc_key.t24p = t24p;
+	cc_key.dTx = sfp_deltaTx;
+	cc_key.dRx = sfp_deltaRx;
+	cc_key.alpha = sfp_alpha;
+	cc_key.chksum = cc_sum(&cc_key);
+	cc_slots[slot] = cc_key;
+	if (eeprom_calcache(slot, &cc_key, 1) < 0)
+		pp_printf("t24p cache: can't write slot %d\n", slot);
+}
+
+void calib_cache_drop(int slot)
+{
+	memset(cc_slots + slot, 0, sizeof(cc_slots[slot]));
+	eeprom_calcache(slot, cc_slots + slot, 1);
+	if (cc_chk.slot == slot)
+		cc_chk.slot = -1;
+}
+
+/*
+ * The flip bit is 1 for half a period of phase after the transition,
+ * and 0 for the other half; near the edges it is unreliable anyways.
+ */
+void calib_cache_poll(void)
+{
+	struct s_calcache *e;
+	int32_t d;
+	int flip;
+
+	if (cc_chk.slot < 0 || time_before(timer_get_tics(), cc_chk.next))
+		return;
+	cc_chk.next = timer_get_tics() + TICS_PER_SECOND;
+	if (!spll_check_lock(0) || spll_shifter_busy(0))
+		return;
+
+	e = cc_slots + cc_chk.slot;
+	spll_get_phase_shift(0, &d, NULL);
+	d -= e->t24p;
+	while (d < 0)
+		d += REF_CLOCK_PERIOD_PS;
+	while (d >= REF_CLOCK_PERIOD_PS)
+		d -= REF_CLOCK_PERIOD_PS;
+	if (d < CC_CHECK_GUARD || d > REF_CLOCK_PERIOD_PS - CC_CHECK_GUARD)
+		return;
+	if (d > REF_CLOCK_PERIOD_PS / 2 - CC_CHECK_GUARD
+	    && d < REF_CLOCK_PERIOD_PS / 2 + CC_CHECK_GUARD)
+		return;
+
+	flip = ep_timestamper_cal_pulse();
+	if (flip == (d < REF_CLOCK_PERIOD_PS / 2))
+		cc_chk.good++;
+	else
+		cc_chk.bad++;
+
+	if (cc_chk.bad > CC_CHECK_MAX_BAD) {
+		pp_printf("t24p cache: %d ps doesn't match, dropped\n",
+			  e->t24p);
+		calib_cache_drop(cc_chk.slot);
+	} else if (cc_chk.good + cc_chk.bad >= CC_CHECK_SAMPLES) {
+		TRACE_DEV("t24p cache: %d ps confirmed (%d/%d)\n", e->t24p,
+			  cc_chk.good, cc_chk.good + cc_chk.bad);
+		cc_chk.slot = -1;
+	}
+}
+
+DEFINE_WRC_TASK(calib_cache, 5) = {
+	.name = "calib-cache",
+	.job = calib_cache_poll,
+	.period = 10,
+	.flags = TASK_LINK,
+};
+
+void calib_cache_show(void)
+{
+	struct s_calcache *e;
+	int i, j;
+
+	for (i = 0; i < CAL_CACHE_SLOTS; i++) {
+		if (!cc_valid(i))
+			continue;
+		e = cc_slots + i;
+		pp_printf("%d: PN:", i);
+		for (j = 0; j < SFP_PN_LEN; j++)
+			pp_printf("%c", e->pn[j] ? e->pn[j] : ' ');
+		pp_printf(" gw %08x ", e->gw);
+		if (e->temp == CC_TEMP_NONE)
+			pp_printf("temp -- ");
+		else
+			pp_printf("temp %d ", e->temp << (CC_TEMP_SHIFT - 16));
+		pp_printf("t24p %d dTx %d dRx %d alpha %d%s\n", e->t24p,
+			  e->dTx, e->dRx, e->alpha,
+			  cc_chk.slot == i ? " (checking)" : "");
+	}
+}
@@ -0,0 +1,139 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <string.h>
+#include <wrc.h>
+#include <task.h>
+
+#include "uart.h"
+#include "console.h"
+
+#define CONS_SIZE	CONFIG_CONSOLE_BUF_SIZE
+
+struct console {
+	unsigned head, tail;	/* free-running, head - tail is the fill */
+	unsigned dropped, reported;
+	int (*put)(int c);	/* returns < 0 if the device is busy */
+	char buf[CONS_SIZE];
+};
+
+static int cons_block;
+
+#ifdef CONFIG_UART
+static struct console cons_main = {.put = uart_try_write_raw};
+#else
+static struct console cons_main = {.put = uart_sw_try_write_raw};
+#endif
+
+#if defined(CONFIG_UART) && defined(CONFIG_UART_SW)
+/* ppsi messages go to the software uart, with a buffer of their own */
+static struct console cons_sw = {.put = uart_sw_try_write_raw};
+#endif
+
+/* Woken while there is something to send, see cons_drain() */
+DEFINE_WRC_TASK(console, 8) = {
+	.name = "console",
+	.job = console_poll,
+	.period = 10,
+	.flags = TASK_EVENT,
+};
+
+/* Move what the device accepts now, never wait */
+static void cons_drain(struct console *c)
+{
+	while (c->head != c->tail && c->put(c->buf[c->tail % CONS_SIZE]) >= 0)
+		c->tail++;
+	if (c->head != c->tail)
+		task_wake(WRC_TASK(console));
+}
+
+static void cons_putc(struct console *c, char ch)
+{
+	while (c->head - c->tail == CONS_SIZE)
+		cons_drain(c);
+	c->buf[c->head++ % CONS_SIZE] = ch;
+}
+
+/* A string that doesn't fit is dropped as a whole, to keep lines sane */
+static int cons_write(struct console *c, const char *s)
+{
+	const char *t = s;
+	int len = 0;
+
+	for (; *s; s++)
+		len += (*s == '\n') ? 2 : 1;
+	s = t;
+	cons_drain(c);
+	if (!cons_block && len > CONS_SIZE - (c->head - c->tail)) {
+		c->dropped += len;
+		return len;
+	}
+	for (; *s; s++) {
+		if (*s == '\n')
+			cons_putc(c, '\r');
+		cons_putc(c, *s);
+	}
+	cons_drain(c);
+	return s - t;
+}
+
+/* Once there's room again, say what we lost */
+static void cons_report(struct console *c)
+{
+	char msg[48];
+
+	if (c->dropped == c->reported || CONS_SIZE - (c->head - c->tail)
+	    < sizeof(msg))
+		return;
+	pp_sprintf(msg, "\n[console: %d characters dropped]\n",
+		   c->dropped - c->reported);
+	c->reported = c->dropped;
+	cons_write(c, msg);
+}
+
+static void cons_flush(struct console *c)
+{
+	while (c->head != c->tail)
+		cons_drain(c);
+}
+
+int puts(const char *s)
+{
+	return cons_write(&cons_main, s);
+}
+
+#if defined(CONFIG_UART) && defined(CONFIG_UART_SW)
+int uart_sw_write_string(const char *s)
+{
+	return cons_write(&cons_sw, s);
+}
+#else
+int uart_sw_write_string(const char *s)
+	__attribute__((alias("puts")));
+#endif
+
+void console_poll(void)
+{
+	cons_drain(&cons_main);
+	cons_report(&cons_main);
+#if defined(CONFIG_UART) && defined(CONFIG_UART_SW)
+	cons_drain(&cons_sw);
+	cons_report(&cons_sw);
+#endif
+}
+
+/* For places that are going to stall anyways: wait until it's all out */
+void console_flush(void)
+{
+	cons_flush(&cons_main);
+#if defined(CONFIG_UART) && defined(CONFIG_UART_SW)
+	cons_flush(&cons_sw);
+#endif
+}
+
+void console_set_blocking(int block)
+{
+	cons_block = block;
+}
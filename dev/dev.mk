@@ -6,6 +6,7 @@ obj-$(CONFIG_WR_NODE) += \
 	dev/pps_gen.o \
 	dev/syscon.o \
 	dev/sfp.o \
+	dev/sfp-db.o \
 	dev/sdb.o \
 	dev/rxts_calibrator.o
 
@@ -13,8 +14,11 @@ obj-$(CONFIG_WR_SWITCH) += dev/timer-wrs.o dev/ad9516.o
 
 obj-$(CONFIG_LEGACY_EEPROM) += dev/eeprom.o
 obj-$(CONFIG_SDB_EEPROM) += dev/sdb-eeprom.o
+obj-$(CONFIG_CALIB_CACHE) += dev/calib-cache.o
+obj-$(CONFIG_NVSTATE) += dev/nvstate.o
 
 obj-$(CONFIG_W1) +=		dev/w1.o	dev/w1-hw.o	dev/w1-shell.o
 obj-$(CONFIG_W1) +=		dev/w1-temp.o	dev/w1-eeprom.o
 obj-$(CONFIG_UART) +=		dev/uart.o
 obj-$(CONFIG_UART_SW) +=	dev/uart-sw.o
+obj-$(CONFIG_CONSOLE_BUF) +=	dev/console.o
@@ -58,27 +58,22 @@
 
 uint8_t has_eeprom = 0;
 
-uint8_t eeprom_present(uint8_t i2cif, uint8_t i2c_addr)
-{
-	has_eeprom = 1;
-	if (!mi2c_devprobe(i2cif, i2c_addr))
-		if (!mi2c_devprobe(i2cif, i2c_addr))
-			has_eeprom = 0;
-
-	return 0;
-}
+/*
+ * Raw access. Reads are sequential, whatever the size; writes must not
+ * cross a page, and are followed by ACK polling: the chip doesn't
+ * answer its address until the write cycle is over.
+ */
+#define EE_PAGE_SIZE		32	/* 24LC64 and friends */
+#define EE_WRITE_TIMEOUT	20	/* ms, the write cycle is 5ms */
 
-static int eeprom_read(uint8_t i2cif, uint8_t i2c_addr, uint32_t offset,
+static int ee_raw_read(uint8_t i2cif, uint8_t i2c_addr, uint32_t offset,
 		       uint8_t * buf, size_t size)
 {
 	int i;
 	unsigned char c;
 
-	if (!has_eeprom)
-		return -1;
-
 	mi2c_start(i2cif);
-	if (mi2c_put_byte(i2cif, i2c_addr << 1) < 0) {
+	if (mi2c_put_byte(i2cif, i2c_addr << 1)) {
 		mi2c_stop(i2cif);
 		return -1;
 	}
@@ -97,49 +92,195 @@ static int eeprom_read(uint8_t i2cif, uint8_t i2c_addr, uint32_t offset,
 	return size;
 }
 
-static int eeprom_write(uint8_t i2cif, uint8_t i2c_addr, uint32_t offset,
-		 uint8_t * buf, size_t size)
+static int ee_raw_write(uint8_t i2cif, uint8_t i2c_addr, uint32_t offset,
+			uint8_t * buf, size_t size)
 {
+	uint32_t t;
 	int i, busy;
 
-	if (!has_eeprom)
+	mi2c_start(i2cif);
+	if (mi2c_put_byte(i2cif, i2c_addr << 1)) {
+		mi2c_stop(i2cif);
 		return -1;
+	}
+	mi2c_put_byte(i2cif, (offset >> 8) & 0xff);
+	mi2c_put_byte(i2cif, offset & 0xff);
+	for (i = 0; i < size; i++)
+		mi2c_put_byte(i2cif, *buf++);
+	mi2c_stop(i2cif);
 
-	for (i = 0; i < size; i++) {
+	t = timer_get_tics() + EE_WRITE_TIMEOUT * TICS_PER_SECOND / 1000;
+	do {		/* wait until the chip becomes ready */
 		mi2c_start(i2cif);
+		busy = mi2c_put_byte(i2cif, i2c_addr << 1);
+		mi2c_stop(i2cif);
+	} while (busy && time_before(timer_get_tics(), t));
+
+	return busy ? -1 : size;
+}
+
+/*
+ * A small cache of whole pages. Reads fill a page with one sequential
+ * read; writes modify the cached page and only mark a dirty range, so
+ * that eeprom_flush() writes each touched page in a single cycle. All
+ * exported functions that write call eeprom_flush() before returning.
+ */
+#define EE_CACHE_PAGES		4
+
+static struct ee_page {
+	int base;		/* -1 if unused */
+	int lo, hi;		/* dirty range, empty if lo >= hi */
+	uint32_t used;		/* for replacement */
+	uint8_t data[EE_PAGE_SIZE];
+} ee_cache[EE_CACHE_PAGES];
+static uint32_t ee_clock;
+
+static void ee_cache_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < EE_CACHE_PAGES; i++) {
+		ee_cache[i].base = -1;
+		ee_cache[i].lo = ee_cache[i].hi = 0;
+	}
+}
+
+static int ee_page_flush(uint8_t i2cif, uint8_t i2c_addr, struct ee_page *p)
+{
+	int ret;
+
+	if (p->lo >= p->hi)
+		return 0;
+	ret = ee_raw_write(i2cif, i2c_addr, p->base + p->lo, p->data + p->lo,
+			   p->hi - p->lo);
+	if (ret < 0)
+		p->base = -1; /* we don't know what the chip has now */
+	p->lo = p->hi = 0;
+	return ret < 0 ? -1 : 0;
+}
+
+static int eeprom_flush(uint8_t i2cif, uint8_t i2c_addr)
+{
+	int i, ret = 0;
+
+	for (i = 0; i < EE_CACHE_PAGES; i++)
+		if (ee_page_flush(i2cif, i2c_addr, ee_cache + i) < 0)
+			ret = -1;
+	return ret;
+}
+
+static struct ee_page *ee_get_page(uint8_t i2cif, uint8_t i2c_addr,
+				   int base)
+{
+	struct ee_page *p, *victim = ee_cache;
+	int i;
+
+	for (i = 0, p = ee_cache; i < EE_CACHE_PAGES; i++, p++) {
+		if (p->base == base)
+			goto out;
+		if (p->base < 0 || (victim->base >= 0 && p->used < victim->used))
+			victim = p;
+	}
+	p = victim;
+	if (p->base >= 0 && ee_page_flush(i2cif, i2c_addr, p) < 0)
+		return NULL;
+	p->base = -1;
+	if (ee_raw_read(i2cif, i2c_addr, base, p->data, EE_PAGE_SIZE)
+	    != EE_PAGE_SIZE)
+		return NULL;
+	p->base = base;
+out:
+	p->used = ++ee_clock;
+	return p;
+}
+
+static int eeprom_read(uint8_t i2cif, uint8_t i2c_addr, uint32_t offset,
+		       uint8_t * buf, size_t size)
+{
+	struct ee_page *p;
+	int done, n, pofs;
+
+	if (!has_eeprom)
+		return -1;
 
-		if (mi2c_put_byte(i2cif, i2c_addr << 1) < 0) {
-			mi2c_stop(i2cif);
+	for (done = 0; done < size; done += n) {
+		pofs = (offset + done) % EE_PAGE_SIZE;
+		n = EE_PAGE_SIZE - pofs;
+		if (n > size - done)
+			n = size - done;
+		p = ee_get_page(i2cif, i2c_addr, offset + done - pofs);
+		if (!p)
 			return -1;
-		}
-		mi2c_put_byte(i2cif, (offset >> 8) & 0xff);
-		mi2c_put_byte(i2cif, offset & 0xff);
-		mi2c_put_byte(i2cif, *buf++);
-		offset++;
-		mi2c_stop(i2cif);
+		memcpy(buf + done, p->data + pofs, n);
+	}
+	return size;
+}
 
-		do {		/* wait until the chip becomes ready */
-			mi2c_start(i2cif);
-			busy = mi2c_put_byte(i2cif, i2c_addr << 1);
-			mi2c_stop(i2cif);
-		} while (busy);
+static int eeprom_write(uint8_t i2cif, uint8_t i2c_addr, uint32_t offset,
+		 uint8_t * buf, size_t size)
+{
+	struct ee_page *p;
+	int done, n, pofs;
 
+	if (!has_eeprom)
+		return -1;
+
+	for (done = 0; done < size; done += n) {
+		pofs = (offset + done) % EE_PAGE_SIZE;
+		n = EE_PAGE_SIZE - pofs;
+		if (n > size - done)
+			n = size - done;
+		p = ee_get_page(i2cif, i2c_addr, offset + done - pofs);
+		if (!p)
+			return -1;
+		memcpy(p->data + pofs, buf + done, n);
+		if (p->lo >= p->hi) {
+			p->lo = pofs;
+			p->hi = pofs + n;
+		}
+		if (pofs < p->lo)
+			p->lo = pofs;
+		if (pofs + n > p->hi)
+			p->hi = pofs + n;
 	}
 	return size;
 }
 
+uint8_t eeprom_present(uint8_t i2cif, uint8_t i2c_addr)
+{
+	ee_cache_invalidate();
+	has_eeprom = 1;
+	if (!mi2c_devprobe(i2cif, i2c_addr))
+		if (!mi2c_devprobe(i2cif, i2c_addr))
+			has_eeprom = 0;
+
+	return 0;
+}
+
 int32_t eeprom_sfpdb_erase(uint8_t i2cif, uint8_t i2c_addr)
 {
 	uint8_t sfpcount = 0;
 
 	//just a dummy function that writes '0' to sfp count field of the SFP DB
 	if (eeprom_write(i2cif, i2c_addr, EE_BASE_SFP, &sfpcount,
-			 sizeof(sfpcount)) != sizeof(sfpcount))
+			 sizeof(sfpcount)) != sizeof(sfpcount)
+	    || eeprom_flush(i2cif, i2c_addr) < 0)
 		return EE_RET_I2CERR;
 	else
 		return sfpcount;
 }
 
+/* Only the count word, so a bad record 0 doesn't hide the others */
+int32_t eeprom_sfp_count(uint8_t i2cif, uint8_t i2c_addr)
+{
+	uint8_t sfpcount;
+
+	if (eeprom_read(i2cif, i2c_addr, EE_BASE_SFP, &sfpcount,
+			sizeof(sfpcount)) != sizeof(sfpcount))
+		return EE_RET_I2CERR;
+	return sfpcount;
+}
+
 int32_t eeprom_get_sfp(uint8_t i2cif, uint8_t i2c_addr, struct s_sfpinfo * sfp,
 		       uint8_t add, uint8_t pos)
 {
@@ -182,46 +323,24 @@ int32_t eeprom_get_sfp(uint8_t i2cif, uint8_t i2c_addr, struct s_sfpinfo * sfp,
 			chksum =
 			    (uint8_t) ((uint16_t) chksum + *(ptr++)) & 0xff;
 		sfp->chksum = chksum;
-		/*add SFP at the end of DB */
-		eeprom_write(i2cif, i2c_addr,
-			     EE_BASE_SFP + sizeof(sfpcount)
-			     + sfpcount * sizeof(struct s_sfpinfo),
-			     (uint8_t *) sfp, sizeof(struct s_sfpinfo));
+		/*add SFP at the end of DB, and only then count it */
+		if (eeprom_write(i2cif, i2c_addr,
+				 EE_BASE_SFP + sizeof(sfpcount)
+				 + sfpcount * sizeof(struct s_sfpinfo),
+				 (uint8_t *) sfp, sizeof(struct s_sfpinfo))
+		    != sizeof(struct s_sfpinfo)
+		    || eeprom_flush(i2cif, i2c_addr) < 0)
+			return EE_RET_I2CERR;
 		sfpcount++;
-		eeprom_write(i2cif, i2c_addr, EE_BASE_SFP, &sfpcount,
-			     sizeof(sfpcount));
+		if (eeprom_write(i2cif, i2c_addr, EE_BASE_SFP, &sfpcount,
+				 sizeof(sfpcount)) != sizeof(sfpcount)
+		    || eeprom_flush(i2cif, i2c_addr) < 0)
+			return EE_RET_I2CERR;
 	}
 
 	return sfpcount;
 }
 
-int8_t eeprom_match_sfp(uint8_t i2cif, uint8_t i2c_addr, struct s_sfpinfo * sfp)
-{
-	uint8_t sfpcount = 1;
-	int8_t i, temp;
-	struct s_sfpinfo dbsfp;
-
-	for (i = 0; i < sfpcount; ++i) {
-		temp = eeprom_get_sfp(WRPC_FMC_I2C, FMC_EEPROM_ADR,
-				      &dbsfp, 0, i);
-		if (!i) {
-			sfpcount = temp;	//only in first round valid sfpcount is returned from eeprom_get_sfp
-			if (sfpcount == 0 || sfpcount == 0xFF)
-				return 0;
-			else if (sfpcount < 0)
-				return sfpcount;
-		}
-		if (!strncmp(dbsfp.pn, sfp->pn, 16)) {
-			sfp->dTx = dbsfp.dTx;
-			sfp->dRx = dbsfp.dRx;
-			sfp->alpha = dbsfp.alpha;
-			return 1;
-		}
-	}
-
-	return 0;
-}
-
 int8_t eeprom_phtrans(uint8_t i2cif, uint8_t i2c_addr, uint32_t * val,
 		      uint8_t write)
 {
@@ -229,7 +348,8 @@ int8_t eeprom_phtrans(uint8_t i2cif, uint8_t i2c_addr, uint32_t * val,
 	if (write) {
 		*val |= (1 << 31);
 		if (eeprom_write(i2cif, i2c_addr, EE_BASE_CAL, (uint8_t *) val,
-		     sizeof(*val)) != sizeof(*val))
+		     sizeof(*val)) != sizeof(*val)
+		    || eeprom_flush(i2cif, i2c_addr) < 0)
 			ret = EE_RET_I2CERR;
 		else
 			ret = 1;
@@ -254,7 +374,8 @@ int8_t eeprom_init_erase(uint8_t i2cif, uint8_t i2c_addr)
 	uint16_t used = 0;
 
 	if (eeprom_write(i2cif, i2c_addr, EE_BASE_INIT, (uint8_t *) & used,
-	     sizeof(used)) != sizeof(used))
+	     sizeof(used)) != sizeof(used)
+	    || eeprom_flush(i2cif, i2c_addr) < 0)
 		return EE_RET_I2CERR;
 	else
 		return used;
@@ -280,12 +401,12 @@ int8_t eeprom_init_add(uint8_t i2cif, uint8_t i2c_addr, const char *args[])
 		if (eeprom_write(i2cif, i2c_addr, EE_BASE_INIT + sizeof(used)
 				 + used, (uint8_t *) args[i], strlen(args[i]))
 		    != strlen(args[i]))
-			return EE_RET_I2CERR;
+			goto err;
 		used += strlen(args[i]);
 		if (eeprom_write(i2cif, i2c_addr, EE_BASE_INIT + sizeof(used)
 				 + used, &separator, sizeof(separator))
 		    != sizeof(separator))
-			return EE_RET_I2CERR;
+			goto err;
 		++used;
 		++i;
 	}
@@ -293,10 +414,13 @@ int8_t eeprom_init_add(uint8_t i2cif, uint8_t i2c_addr, const char *args[])
 	separator = '\n';
 	if (eeprom_write(i2cif, i2c_addr, EE_BASE_INIT + sizeof(used) + used-1,
 	     &separator, sizeof(separator)) != sizeof(separator))
+		goto err;
+	//write the command out, and only then update the size of the script
+	if (eeprom_flush(i2cif, i2c_addr) < 0)
 		return EE_RET_I2CERR;
-	//and finally update the size of the script
 	if (eeprom_write(i2cif, i2c_addr, EE_BASE_INIT, (uint8_t *) & used,
-	     sizeof(used)) != sizeof(used))
+	     sizeof(used)) != sizeof(used)
+	    || eeprom_flush(i2cif, i2c_addr) < 0)
 		return EE_RET_I2CERR;
 
 	if (eeprom_read(i2cif, i2c_addr, EE_BASE_INIT, (uint8_t *) & readback,
@@ -304,6 +428,10 @@ int8_t eeprom_init_add(uint8_t i2cif, uint8_t i2c_addr, const char *args[])
 		return EE_RET_I2CERR;
 
 	return 0;
+err:
+	/* drop the partial command: the size field wasn't touched */
+	ee_cache_invalidate();
+	return EE_RET_I2CERR;
 }
 
 int32_t eeprom_init_show(uint8_t i2cif, uint8_t i2c_addr)
@@ -330,6 +458,28 @@ int32_t eeprom_init_show(uint8_t i2cif, uint8_t i2c_addr)
 	return 0;
 }
 
+/*
+ * Reads the whole script in one go; returns its size, and if that is
+ * larger than bufsize nothing is read (like snprintf)
+ */
+int eeprom_init_read(uint8_t i2cif, uint8_t i2c_addr, uint8_t *buf,
+		     int bufsize)
+{
+	uint16_t used;
+
+	if (eeprom_read(i2cif, i2c_addr, EE_BASE_INIT, (uint8_t *) & used,
+	     sizeof(used)) != sizeof(used))
+		return EE_RET_I2CERR;
+	if (used == 0xffff)
+		used = 0;	//this means the memory is blank
+	if (used == 0 || used > bufsize)
+		return used;
+	if (eeprom_read(i2cif, i2c_addr, EE_BASE_INIT + sizeof(used), buf,
+			used) != used)
+		return EE_RET_I2CERR;
+	return used;
+}
+
 int8_t eeprom_init_readcmd(uint8_t i2cif, uint8_t i2c_addr, uint8_t *buf,
 			   uint8_t bufsize, uint8_t next)
 {
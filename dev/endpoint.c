@@ -15,6 +15,7 @@ LGPL 2.1
 #include "syscon.h"
 #include <endpoint.h>
 #include "eeprom.h"
+#include "tempcomp.h"
 
 #include <hw/endpoint_regs.h>
 #include <hw/endpoint_mdio.h>
@@ -164,6 +165,10 @@ int ep_get_deltas(uint32_t * delta_tx, uint32_t * delta_rx)
 	    sfp_deltaRx +
 	    PICOS_PER_SERIAL_BIT *
 	    MDIO_WR_SPEC_BSLIDE_R(pcs_read(MDIO_REG_WR_SPEC));
+#ifdef CONFIG_TEMPCOMP
+	*delta_tx += tempcomp.dtx;
+	*delta_rx += tempcomp.drx;
+#endif
 	return 0;
 }
 
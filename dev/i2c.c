@@ -11,15 +11,49 @@
 #include "board.h"
 #include "syscon.h"
 
-#define I2C_DELAY 300
+#define I2C_DELAY 300		/* loops, unless mi2c_set_speed() is used */
+#define I2C_CAL_MS 4
 
-void mi2c_delay()
+static int mi2c_loops = I2C_DELAY;
+
+static void __mi2c_spin(int n)
 {
-	int i;
-	for (i = 0; i < I2C_DELAY; i++)
+	while (n-- > 0)
 		asm volatile ("nop");
 }
 
+void mi2c_delay()
+{
+	__mi2c_spin(mi2c_loops);
+}
+
+/*
+ * Size the delay from the timer instead of using a fixed loop. A bit
+ * takes three delays (see mi2c_put_byte), so at khz each delay is
+ * 1/(3 * khz) ms; the gpio accesses only make it a little slower.
+ * A speed of 0 restores the fixed delay.
+ */
+void mi2c_set_speed(int khz)
+{
+	uint32_t t;
+	int n = 0;
+
+	if (khz <= 0) {
+		mi2c_loops = I2C_DELAY;
+		return;
+	}
+	t = timer_get_tics();
+	while (timer_get_tics() == t)
+		;
+	t = timer_get_tics() + I2C_CAL_MS * TICS_PER_SECOND / 1000;
+	while (time_before(timer_get_tics(), t)) {
+		__mi2c_spin(1000);
+		n++;
+	}
+	/* we did n thousand loops in I2C_CAL_MS */
+	mi2c_loops = n * 1000 / (I2C_CAL_MS * 3 * khz) + 1;
+}
+
 #define M_SDA_OUT(i, x) { gpio_out(i2c_if[i].sda, x); mi2c_delay(); }
 #define M_SCL_OUT(i, x) { gpio_out(i2c_if[i].scl, x); mi2c_delay(); }
 #define M_SDA_IN(i) gpio_in(i2c_if[i].sda)
@@ -240,10 +240,10 @@ int minic_rx_frame(uint8_t * hdr, uint8_t * payload, uint32_t buf_size,
 					payload_size + 4, 2);
 			EXPLODE_WR_TIMESTAMP(raw_ts, counter_r, counter_f);
 
-			shw_pps_gen_get_time(&sec, &counter_ppsg);
+			shw_pps_gen_get_time_cycles(&sec, &counter_ppsg);
 
 			if (counter_r > 3 * REF_CLOCK_FREQ_HZ / 4
-			    && counter_ppsg < 250000000)
+			    && counter_ppsg < REF_CLOCK_FREQ_HZ / 4)
 				sec--;
 
 			hwts->sec = sec & 0x7fffffff;
@@ -335,7 +335,7 @@ int minic_tx_frame(uint8_t * hdr, uint8_t * payload, uint32_t size,
 		uint16_t fid;
 		uint32_t counter_r, counter_f;
 		uint64_t sec;
-		uint32_t nsec;
+		uint32_t cycles;
 
 		/* wait for the timestamp */
 		for (i = 0; i < 100; ++i) {
@@ -361,14 +361,16 @@ int minic_tx_frame(uint8_t * hdr, uint8_t * payload, uint32_t size,
 		fid = MINIC_TSR0_FID_R(minic_readl(MINIC_REG_TSR0));
 
 		if (fid != WRPC_FID) {
-			TRACE_DEV("minic_tx_frame: unmatched fid %d vs %d\n",
+			TRACE_LOG(TRACE_WARNING,
+				  "minic_tx_frame: unmatched fid %d vs %d\n",
 				  fid, WRPC_FID);
 		}
 
 		EXPLODE_WR_TIMESTAMP(raw_ts, counter_r, counter_f);
-		shw_pps_gen_get_time(&sec, &nsec);
+		shw_pps_gen_get_time_cycles(&sec, &cycles);
 
-		if (counter_r > 3 * REF_CLOCK_FREQ_HZ / 4 && nsec < 250000000)
+		if (counter_r > 3 * REF_CLOCK_FREQ_HZ / 4
+		    && cycles < REF_CLOCK_FREQ_HZ / 4)
 			sec--;
 
 		hwts->valid = ts_valid;
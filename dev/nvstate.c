@@ -0,0 +1,295 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * A log of small records, so that state we save periodically doesn't
+ * wear out a single eeprom page. The file is an array of NV_SLOTS
+ * records; each carries a key, a sequence number and a crc, and the
+ * valid record with the highest sequence number for a key is its
+ * current value. New records go to the next slot after the newest
+ * one, skipping the slots that hold a current value: everything else
+ * is garbage, so rewriting a key spreads over all the free slots and
+ * a failed write leaves the previous value in place.
+ *
+ * At boot all slots are read once, to build the index; then values
+ * are changed in RAM and written by nvstate_poll(), one record at a
+ * time, so the main loop only ever waits for a single page write.
+ */
+#include <stddef.h>
+#include <string.h>
+#include <wrc.h>
+#include <task.h>
+
+#include "softpll_ng.h"
+#include "eeprom.h"
+#include "crc16.h"
+#include "nvstate.h"
+
+#define NV_WRITE_GAP	TICS_PER_SECOND	/* between two writes */
+
+#if NV_SLOTS <= NV_KEYS
+#error "The state log needs more slots than keys"
+#endif
+
+/* Minimum time between writes of the same key, in seconds */
+static const uint16_t nv_period[NV_KEYS] = {
+	[NV_UPTIME] = 600,
+	[NV_DELOCKS] = 60,
+	[NV_DAC] = 600,
+	[NV_T24P] = 0,
+};
+
+static struct nv_entry {
+	int slot;		/* where the current value is, or -1 */
+	int dirty;
+	uint32_t written;	/* tics */
+	uint8_t len;
+	uint8_t data[NV_DATA_LEN];
+} nv_idx[NV_KEYS];
+
+static struct {
+	int present;		/* the file is there */
+	int head;		/* next slot to try */
+	uint32_t seq;		/* next sequence number */
+	uint32_t next_write;	/* tics */
+	uint32_t uptime, tics;	/* seconds, and tics when it was updated */
+	uint32_t delocks, last_delock_count;
+	int writes, errors;
+} nv;
+
+static uint16_t nv_crc(struct s_nvrec *r)
+{
+	uint16_t crc = crc16(0xffff, r, offsetof(struct s_nvrec, crc));
+
+	return crc16(crc, r->data, sizeof(r->data));
+}
+
+static int nv_valid(struct s_nvrec *r)
+{
+	return r->seq != 0 && r->seq != ~0 && r->key < NV_KEYS
+		&& r->len <= NV_DATA_LEN && r->crc == nv_crc(r);
+}
+
+static int nv_slot_used(int slot)
+{
+	int k;
+
+	for (k = 0; k < NV_KEYS; k++)
+		if (nv_idx[k].slot == slot)
+			return 1;
+	return 0;
+}
+
+void nvstate_init(void)
+{
+	struct s_nvrec r;
+	uint32_t seqs[NV_KEYS], newest = 0;
+	int i, k, any = 0;
+
+	memset(nv_idx, 0, sizeof(nv_idx));
+	for (k = 0; k < NV_KEYS; k++)
+		nv_idx[k].slot = -1;
+	nv.present = 0;
+	nv.head = 0;
+	nv.seq = 1;
+
+	for (i = 0; i < NV_SLOTS; i++) {
+		if (eeprom_nvstate(i, &r, 0) < 0) {
+			if (i == 0)
+				return; /* no file, or no eeprom */
+			continue;
+		}
+		nv.present = 1;
+		if (!nv_valid(&r))
+			continue;
+		/* sequence numbers wrap: compare the difference */
+		if (!any || (int32_t)(r.seq - newest) > 0) {
+			newest = r.seq;
+			nv.head = (i + 1) % NV_SLOTS;
+			any = 1;
+		}
+		k = r.key;
+		if (nv_idx[k].slot >= 0 && (int32_t)(r.seq - seqs[k]) < 0)
+			continue;
+		seqs[k] = r.seq;
+		nv_idx[k].slot = i;
+		nv_idx[k].len = r.len;
+		memcpy(nv_idx[k].data, r.data, NV_DATA_LEN);
+	}
+	if (any)
+		nv.seq = newest + 1;
+	if (nv.seq == 0 || nv.seq == ~0)
+		nv.seq = 1;
+	for (k = 0; k < NV_KEYS; k++)
+		nv_idx[k].written = timer_get_tics();
+
+	nv.tics = timer_get_tics();
+	nvstate_get(NV_UPTIME, &nv.uptime, sizeof(nv.uptime));
+	nvstate_get(NV_DELOCKS, &nv.delocks, sizeof(nv.delocks));
+}
+
+int nvstate_get(int key, void *buf, int len)
+{
+	struct nv_entry *e = nv_idx + key;
+
+	if (key < 0 || key >= NV_KEYS || (e->slot < 0 && !e->dirty))
+		return -1;
+	if (len > e->len)
+		len = e->len;
+	memcpy(buf, e->data, len);
+	return len;
+}
+
+/* Returns -1 if there is no state file, and the value won't be saved */
+int nvstate_set(int key, const void *buf, int len)
+{
+	struct nv_entry *e = nv_idx + key;
+
+	if (!nv.present || key < 0 || key >= NV_KEYS || len > NV_DATA_LEN)
+		return -1;
+	if ((e->slot >= 0 || e->dirty) && e->len == len
+	    && !memcmp(e->data, buf, len))
+		return 0; /* nothing new */
+	memset(e->data, 0, NV_DATA_LEN);
+	memcpy(e->data, buf, len);
+	e->len = len;
+	e->dirty = 1;
+	return 0;
+}
+
+/* Append the value of a key, in the first slot we can overwrite */
+static int nv_write(int key)
+{
+	struct nv_entry *e = nv_idx + key;
+	struct s_nvrec r;
+	int slot, i;
+
+	for (i = 0, slot = nv.head; i < NV_SLOTS; i++) {
+		if (!nv_slot_used(slot))
+			break;
+		slot = (slot + 1) % NV_SLOTS;
+	}
+	r.seq = nv.seq;
+	r.key = key;
+	r.len = e->len;
+	memcpy(r.data, e->data, NV_DATA_LEN);
+	r.crc = nv_crc(&r);
+
+	/* Move on anyways: if the slot is bad we won't retry it first */
+	nv.head = (slot + 1) % NV_SLOTS;
+	if (eeprom_nvstate(slot, &r, 1) < 0) {
+		nv.errors++;
+		return -1;
+	}
+	if (++nv.seq == ~0)
+		nv.seq = 1;
+	e->slot = slot;
+	e->dirty = 0;
+	e->written = timer_get_tics();
+	nv.writes++;
+	return 0;
+}
+
+/* Refresh the values we collect ourselves */
+static void nv_collect(void)
+{
+	uint32_t v;
+	int count;
+
+	/* The tic counter wraps in 49 days: count elapsed seconds */
+	v = (timer_get_tics() - nv.tics) / TICS_PER_SECOND;
+	nv.uptime += v;
+	nv.tics += v * TICS_PER_SECOND;
+	nvstate_set(NV_UPTIME, &nv.uptime, sizeof(nv.uptime));
+
+	count = spll_get_delock_count();
+	if (count != nv.last_delock_count) {
+		/* spll_init() restarts the count from zero */
+		if (count > nv.last_delock_count)
+			nv.delocks += count - nv.last_delock_count;
+		else
+			nv.delocks += count;
+		nv.last_delock_count = count;
+		nvstate_set(NV_DELOCKS, &nv.delocks, sizeof(nv.delocks));
+	}
+
+	if (spll_check_lock(0)) {
+		v = spll_get_dac(0);
+		nvstate_set(NV_DAC, &v, sizeof(v));
+	}
+}
+
+void nvstate_poll(void)
+{
+	uint32_t now = timer_get_tics();
+	int k;
+
+	if (!nv.present || time_before(now, nv.next_write))
+		return;
+	nv.next_write = now + NV_WRITE_GAP;
+	nv_collect();
+
+	for (k = 0; k < NV_KEYS; k++) {
+		if (!nv_idx[k].dirty)
+			continue;
+		if (time_before(now, nv_idx[k].written
+				+ nv_period[k] * TICS_PER_SECOND))
+			continue;
+		nv_write(k);
+		return; /* one per call */
+	}
+}
+
+DEFINE_WRC_TASK(nvstate, 6) = {
+	.name = "nvstate",
+	.job = nvstate_poll,
+	.period = 10,
+};
+
+int nvstate_erase(void)
+{
+	struct s_nvrec r;
+	int i, k;
+
+	memset(&r, 0, sizeof(r));
+	for (i = 0; i < NV_SLOTS; i++)
+		if (eeprom_nvstate(i, &r, 1) < 0)
+			return -1;
+	for (k = 0; k < NV_KEYS; k++) {
+		nv_idx[k].slot = -1;
+		nv_idx[k].dirty = 0;
+	}
+	nv.uptime = nv.delocks = 0;
+	nv.head = 0;
+	return 0;
+}
+
+void nvstate_show(void)
+{
+	static const char *names[NV_KEYS] = {
+		[NV_UPTIME] = "uptime", [NV_DELOCKS] = "delocks",
+		[NV_DAC] = "dac", [NV_T24P] = "t24p",
+	};
+	uint32_t v = 0;
+	int k, used = 0;
+
+	if (!nv.present) {
+		pp_printf("no \"wr-state\" file in the eeprom\n");
+		return;
+	}
+	for (k = 0; k < NV_KEYS; k++) {
+		if (nv_idx[k].slot >= 0)
+			used++;
+		if (nvstate_get(k, &v, sizeof(v)) < 0) {
+			pp_printf("%s:\t--\n", names[k]);
+			continue;
+		}
+		pp_printf("%s:\t%d\tslot %d%s\n", names[k], v,
+			  nv_idx[k].slot, nv_idx[k].dirty ? " (pending)" : "");
+	}
+	pp_printf("%d of %d slots in use, next seq %d, %d writes, "
+		  "%d errors\n", used, NV_SLOTS, nv.seq, nv.writes, nv.errors);
+}
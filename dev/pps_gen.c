@@ -11,6 +11,7 @@
 #include <wrc.h>
 #include "board.h"
 #include "pps_gen.h"
+#include "fixdiv.h"
 
 #include "hw/pps_gen_regs.h"
 
@@ -25,6 +26,47 @@
 #define ppsg_read(reg) \
 	*(volatile uint32_t *) (BASE_PPS_GEN + (offsetof(struct PPSG_WB, reg)))
 
+/*
+ * Seconds are only read from hardware once per second: we keep the
+ * last value, with the cycle counter and timer tics when it was read.
+ * A later cycle count not smaller than the cached one, read less than
+ * a second later, belongs to the same second. Writers make seq odd
+ * while they update; readers retry if seq is odd or changes under them.
+ * An adjustment only lands at the next PPS: while it is pending
+ * (adjusting) the cache is neither filled nor trusted.
+ */
+static struct {
+	volatile uint32_t seq;
+	int valid;
+	int adjusting;
+	uint64_t sec;
+	uint32_t cycles;
+	uint32_t tics;
+} ppsg_cache;
+
+/* Margin (in tics) on the "less than one second" rule above */
+#define PPSG_CACHE_MARGIN 10
+
+static void ppsg_cache_invalidate(int adjusting)
+{
+	ppsg_cache.seq++;
+	ppsg_cache.valid = 0;
+	ppsg_cache.adjusting = adjusting;
+	ppsg_cache.tics = timer_get_tics();
+	ppsg_cache.seq++;
+}
+
+/* Returns 1 while an adjustment is pending; invalidates once it landed */
+static int ppsg_cache_adjusting(void)
+{
+	if (!ppsg_cache.adjusting)
+		return 0;
+	if (shw_pps_gen_busy())
+		return 1;
+	ppsg_cache_invalidate(0);
+	return 0;
+}
+
 void shw_pps_gen_init()
 {
 	uint32_t cr;
@@ -45,16 +87,23 @@ void shw_pps_gen_init()
 /* Adjusts the nanosecond (refclk cycle) counter by atomically adding (how_much) cycles. */
 int shw_pps_gen_adjust(int counter, int64_t how_much)
 {
+	ppsg_cache_invalidate(1);
+
 	TRACE_DEV("Adjust: counter = %s [%c%d]\n",
 		  counter == PPSG_ADJUST_SEC ? "seconds" : "nanoseconds",
 		  how_much < 0 ? '-' : '+', (int32_t) abs(how_much));
 
 	if (counter == PPSG_ADJUST_NSEC) {
+		/* Nanosecond adjustments are always less than a second */
+		int32_t ns = how_much;
+
+		if (ns >= 0)
+			ns = FIXMULDIV(ns, 1000, REF_CLOCK_PERIOD_PS);
+		else
+			ns = -FIXMULDIV(-ns, 1000, REF_CLOCK_PERIOD_PS);
 		ppsg_write(ADJ_UTCLO, 0);
 		ppsg_write(ADJ_UTCHI, 0);
-		ppsg_write(ADJ_NSEC,
-			   (int32_t) ((int64_t) how_much * 1000LL /
-				      (int64_t) REF_CLOCK_PERIOD_PS));
+		ppsg_write(ADJ_NSEC, ns);
 	} else {
 		ppsg_write(ADJ_UTCLO, (uint32_t) (how_much & 0xffffffffLL));
 		ppsg_write(ADJ_UTCHI, (uint32_t) (how_much >> 32) & 0xff);
@@ -68,11 +117,11 @@ int shw_pps_gen_adjust(int counter, int64_t how_much)
 /* Sets the current time */
 void shw_pps_gen_set_time(uint64_t seconds, uint32_t nanoseconds, int counter)
 {
+	ppsg_cache_invalidate(0);
+
 	ppsg_write(ADJ_UTCLO, (uint32_t) (seconds & 0xffffffffLL));
 	ppsg_write(ADJ_UTCHI, (uint32_t) (seconds >> 32) & 0xff);
-	ppsg_write(ADJ_NSEC,
-		   (int32_t) ((int64_t) nanoseconds * 1000LL /
-			      (int64_t) REF_CLOCK_PERIOD_PS));
+	ppsg_write(ADJ_NSEC, FIXMULDIV(nanoseconds, 1000, REF_CLOCK_PERIOD_PS));
 
 	if (counter == PPSG_SET_ALL)
 		ppsg_write(CR, (ppsg_read(CR) & 0xfffffffb) | PPSG_CR_CNT_SET);
@@ -96,8 +145,10 @@ uint64_t pps_get_utc(void)
 	return out;
 }
 
-void shw_pps_gen_get_time(uint64_t * seconds, uint32_t * nanoseconds)
+/* Slow path: read all counters until the seconds are stable, refill cache */
+static void ppsg_read_counters(uint64_t *seconds, uint32_t *cycles)
 {
+	uint32_t now = timer_get_tics();
 	uint32_t ns_cnt;
 	uint64_t sec1, sec2;
 
@@ -107,12 +158,58 @@ void shw_pps_gen_get_time(uint64_t * seconds, uint32_t * nanoseconds)
 		sec2 = pps_get_utc();
 	} while (sec2 != sec1);
 
+	*seconds = sec2;
+	*cycles = ns_cnt;
+
+	/* Don't cache while a just-requested adjustment may be in flight */
+	if (ppsg_cache_adjusting())
+		return;
+	if (!ppsg_cache.valid && !time_after(now, ppsg_cache.tics + 1))
+		return;
+	ppsg_cache.seq++;
+	ppsg_cache.sec = sec2;
+	ppsg_cache.cycles = ns_cnt;
+	ppsg_cache.tics = now;
+	ppsg_cache.valid = 1;
+	ppsg_cache.seq++;
+}
+
+void shw_pps_gen_get_time_cycles(uint64_t * seconds, uint32_t * cycles)
+{
+	uint32_t seq, ns_cnt, now;
+	uint64_t sec;
+	int hit;
+
+	do {
+		seq = ppsg_cache.seq;
+		ns_cnt = ppsg_read(CNTR_NSEC) & 0xFFFFFFFUL;
+		now = timer_get_tics();
+		hit = ppsg_cache.valid && !ppsg_cache.adjusting
+		    && ns_cnt >= ppsg_cache.cycles
+		    && time_before(now, ppsg_cache.tics + TICS_PER_SECOND
+				   - PPSG_CACHE_MARGIN);
+		sec = ppsg_cache.sec;
+	} while ((seq & 1) || seq != ppsg_cache.seq);
+
+	if (!hit)
+		ppsg_read_counters(&sec, &ns_cnt);
 	if (seconds)
-		*seconds = sec2;
+		*seconds = sec;
+	if (cycles)
+		*cycles = ns_cnt;
+}
+
+void shw_pps_gen_get_time(uint64_t * seconds, uint32_t * nanoseconds)
+{
+	uint32_t ns_cnt;
+
+	shw_pps_gen_get_time_cycles(seconds, &ns_cnt);
 	if (nanoseconds)
-		*nanoseconds =
-		    (uint32_t) ((int64_t) ns_cnt *
-				(int64_t) REF_CLOCK_PERIOD_PS / 1000LL);
+#if REF_CLOCK_PERIOD_PS % 1000 == 0
+		*nanoseconds = ns_cnt * (REF_CLOCK_PERIOD_PS / 1000);
+#else
+		*nanoseconds = FIXMULDIV(ns_cnt, REF_CLOCK_PERIOD_PS, 1000);
+#endif
 }
 
 /* Returns 1 when the adjustment operation is not yet finished */
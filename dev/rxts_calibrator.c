@@ -19,6 +19,7 @@
 #include "wrc_ptp.h"
 #include "eeprom.h"
 #include "ptpd_netif.h"
+#include "rxts_calibrator.h"
 
 /* New calibrator for the transition phase value. A major pain in the ass for
    the folks who frequently rebuild their gatewares. The idea is described
@@ -51,6 +52,19 @@
 #define CAL_SCAN_RANGE (REF_CLOCK_PERIOD_PS + \
 		(3 * CAL_DEGLITCH_THRESHOLD * CAL_SCAN_STEP))
 
+/* coarse-to-fine search: the coarse step brackets each transition, then
+   we bisect down to CAL_SCAN_STEP, deglitching each probe with a vote
+   (see rxts_vote). Where we know more or less where to look, we use the
+   shorter "near" step */
+#define CAL_COARSE_STEP (REF_CLOCK_PERIOD_PS / 8)
+#define CAL_NEAR_STEP (4 * CAL_SCAN_STEP)
+
+/* falling and rising transitions must be half a period apart, give or take */
+#define CAL_MAX_SKEW (REF_CLOCK_PERIOD_PS / 8)
+
+/* how many near steps before we give up: enough to cover the skew */
+#define CAL_NEAR_STEPS (2 * CAL_MAX_SKEW / CAL_NEAR_STEP + 2)
+
 #define TD_WAIT_INACTIVE	0
 #define TD_GOT_TRANSITION	1
 #define TD_DONE			2
@@ -113,11 +127,40 @@ static int lookup_transition(struct trans_detect_state *state, int flip_bit,
 static struct trans_detect_state det_rising, det_falling;
 static int cal_cur_phase;
 
-/* Starts RX timestamper calibration process state machine. Invoked by
-   ptpnetif's check lock function when the PLL has already locked, to avoid
-   complicating the API of ptp-noposix/ppsi. */
+/* rxts_cal_linear selects the original full scan; the fast search falls
+   back on it by itself if what it finds doesn't make sense */
+int rxts_cal_linear;
+
+#define FS_GUESS	0	/* around the transitions we found last time */
+#define FS_BLIND	1	/* forward from 0, like the linear scan */
+#define FS_LINEAR	2
+
+static struct {
+	int mode;		/* FS_GUESS, FS_BLIND or FS_LINEAR */
+	int bisect;		/* 0 while stepping, 1 while bisecting */
+	int dir;		/* +1 or -1: direction of coarse steps */
+	int step;
+	int steps_left;
+	int prev_val;		/* flip bit at the previous coarse phase */
+	int expect_val;		/* ... or the value we expect, if >= 0 */
+	int old, new;		/* bracket: old has old_val, new has !old_val */
+	int old_val;
+	int found;		/* mask: 1 = rising, 2 = falling */
+	uint32_t start_tics;
+} fs;
+
+struct rxts_cal_stats rxts_cal_stats;
+static uint32_t cal_link_tics;
+
+/* Called at link up: the time to calibrate is counted from here */
+void rxts_link_up(void)
+{
+	cal_link_tics = timer_get_tics();
+}
 
-void rxts_calibration_start()
+static void rxts_fast_start(int mode);
+
+static void rxts_linear_start(void)
 {
 	cal_cur_phase = 0;
 	det_rising.prev_val = det_falling.prev_val = -1;
@@ -129,15 +172,65 @@ void rxts_calibration_start()
 	spll_set_phase_shift(0, 0);
 }
 
-/* Updates RX timestamper state machine. Non-zero return value means that
-   calibration is done. */
-int rxts_calibration_update(uint32_t *t24p_value)
+/* Starts RX timestamper calibration process state machine. Invoked by
+   ptpnetif's check lock function when the PLL has already locked, to avoid
+   complicating the API of ptp-noposix/ppsi. */
+
+void rxts_calibration_start()
+{
+	rxts_linear_start();
+	fs.start_tics = timer_get_tics();
+	if (rxts_cal_linear)
+		fs.mode = FS_LINEAR;
+	else
+		rxts_fast_start(cal_phase_transition < REF_CLOCK_PERIOD_PS ?
+				FS_GUESS : FS_BLIND);
+}
+
+/* Combine rising and falling edge phases into the transition phase */
+static int rxts_calibration_done(uint32_t *t24p_value)
 {
 	int32_t ttrans = 0;
 
-	if (spll_shifter_busy(0))
-		return 0;
+	/* normalize (the fast search may use negative phases, too) */
+	while (det_falling.trans_phase < 0)
+		det_falling.trans_phase += REF_CLOCK_PERIOD_PS;
+	while (det_rising.trans_phase < 0)
+		det_rising.trans_phase += REF_CLOCK_PERIOD_PS;
+	while (det_falling.trans_phase >= REF_CLOCK_PERIOD_PS)
+		det_falling.trans_phase -= REF_CLOCK_PERIOD_PS;
+	while (det_rising.trans_phase >= REF_CLOCK_PERIOD_PS)
+		det_rising.trans_phase -= REF_CLOCK_PERIOD_PS;
+
+	/* Use falling edge as second sample of rising edge */
+	if (det_falling.trans_phase > det_rising.trans_phase)
+		ttrans = det_falling.trans_phase - REF_CLOCK_PERIOD_PS/2;
+	else if(det_falling.trans_phase < det_rising.trans_phase)
+		ttrans = det_falling.trans_phase + REF_CLOCK_PERIOD_PS/2;
+	ttrans += det_rising.trans_phase;
+	ttrans /= 2;
+
+	/*normalize ttrans*/
+	if(ttrans < 0) ttrans += REF_CLOCK_PERIOD_PS;
+	if(ttrans >= REF_CLOCK_PERIOD_PS) ttrans -= REF_CLOCK_PERIOD_PS;
+
+
+	rxts_cal_stats.linear = (fs.mode == FS_LINEAR);
+	rxts_cal_stats.scan_ms = (timer_get_tics() - fs.start_tics)
+		* 1000 / TICS_PER_SECOND;
+	rxts_cal_stats.link_ms = (timer_get_tics() - cal_link_tics)
+		* 1000 / TICS_PER_SECOND;
+
+	TRACE_DEV("RXTS calibration: R@%dps, F@%dps, transition@%dps\n",
+		  det_rising.trans_phase, det_falling.trans_phase,
+		  ttrans);
+
+	*t24p_value = (uint32_t)ttrans;
+	return 1;
+}
 
+static int rxts_linear_update(uint32_t *t24p_value)
+{
 	/* generate a fake RX timestamp and check if falling edge counter is
 	   ahead of rising edge counter */
 	int flip = ep_timestamper_cal_pulse();
@@ -149,44 +242,189 @@ int rxts_calibration_update(uint32_t *t24p_value)
 	if (cal_cur_phase >= CAL_SCAN_RANGE) {
 		if (det_rising.state != TD_DONE || det_falling.state != TD_DONE) 
 		{
-			TRACE_DEV("RXTS calibration error.\n");
+			TRACE_LOG(TRACE_WARNING, "RXTS calibration error.\n");
 			return -1;
 		}
+		return rxts_calibration_done(t24p_value);
+	}
 
-		/* normalize */
-		while (det_falling.trans_phase >= REF_CLOCK_PERIOD_PS)
-			det_falling.trans_phase -= REF_CLOCK_PERIOD_PS;
-		while (det_rising.trans_phase >= REF_CLOCK_PERIOD_PS)
-			det_rising.trans_phase -= REF_CLOCK_PERIOD_PS;
+	cal_cur_phase += CAL_SCAN_STEP;
 
-		/* Use falling edge as second sample of rising edge */
-		if (det_falling.trans_phase > det_rising.trans_phase)
-			ttrans = det_falling.trans_phase - REF_CLOCK_PERIOD_PS/2;
-		else if(det_falling.trans_phase < det_rising.trans_phase)
-			ttrans = det_falling.trans_phase + REF_CLOCK_PERIOD_PS/2;
-		ttrans += det_rising.trans_phase;
-		ttrans /= 2;
+	spll_set_phase_shift(0, cal_cur_phase);
 
-		/*normalize ttrans*/
-		if(ttrans < 0) ttrans += REF_CLOCK_PERIOD_PS;
-		if(ttrans >= REF_CLOCK_PERIOD_PS) ttrans -= REF_CLOCK_PERIOD_PS;
+	return 0;
+}
 
+/*
+ * lookup_transition() deglitches over CAL_DEGLITCH_THRESHOLD successive
+ * phase steps, so it needs the shifter to travel across each edge, and
+ * travel is what we are saving here. So a probe takes the value that
+ * CAL_DEGLITCH_THRESHOLD fake timestamps agree on at the same phase: a
+ * majority of 2 * threshold - 1, usually known after threshold samples.
+ */
+static int rxts_vote(void)
+{
+	int n[2] = {0, 0};
+
+	for (;;) {
+		n[ep_timestamper_cal_pulse()]++;
+		if (n[0] >= CAL_DEGLITCH_THRESHOLD)
+			return 0;
+		if (n[1] >= CAL_DEGLITCH_THRESHOLD)
+			return 1;
+	}
+}
 
-		TRACE_DEV("RXTS calibration: R@%dps, F@%dps, transition@%dps\n",
-			  det_rising.trans_phase, det_falling.trans_phase,
-			  ttrans);
+static void rxts_fast_goto(int phase)
+{
+	cal_cur_phase = phase;
+	spll_set_phase_shift(0, phase);
+}
 
-		*t24p_value = (uint32_t)ttrans;
-		return 1;
+/* Start stepping from "phase" in direction "dir" */
+static void rxts_fast_steps(int phase, int dir, int step, int steps,
+			    int expect)
+{
+	fs.bisect = 0;
+	fs.dir = dir;
+	fs.step = step;
+	fs.steps_left = steps;
+	fs.prev_val = -1;
+	fs.expect_val = expect;
+	rxts_fast_goto(phase);
+}
+
+/*
+ * Travelling with the shifter is what takes time (the linear scan is
+ * mostly waiting for spll_shifter_busy), so we go as little as possible.
+ * The transitions are half a period apart: in FS_GUESS we go to the one
+ * of last time that is closest to the current shift (zero), possibly at
+ * a negative phase, and then on in the same direction to the other one.
+ * In FS_BLIND we have no idea and step forward from zero.
+ */
+static void rxts_fast_start(int mode)
+{
+	int t, near, dist, i;
+
+	fs.mode = mode;
+	fs.found = 0;
+	if (mode == FS_BLIND) {
+		rxts_fast_steps(0, 1, CAL_COARSE_STEP,
+				CAL_SCAN_RANGE / CAL_COARSE_STEP + 1, -1);
+		return;
 	}
+	near = cal_phase_transition;
+	for (i = 0; i < 4; i++) {
+		t = cal_phase_transition + i * REF_CLOCK_PERIOD_PS / 2
+			- REF_CLOCK_PERIOD_PS;
+		dist = t < 0 ? -t : t;
+		if (dist < (near < 0 ? -near : near))
+			near = t;
+	}
+	if (near >= 0)
+		rxts_fast_steps(near - CAL_NEAR_STEP, 1, CAL_NEAR_STEP,
+				CAL_NEAR_STEPS, -1);
+	else
+		rxts_fast_steps(near + CAL_NEAR_STEP, -1, CAL_NEAR_STEP,
+				CAL_NEAR_STEPS, -1);
+}
 
-	cal_cur_phase += CAL_SCAN_STEP;
+/* Something is odd (glitches, no transitions): try harder */
+static int rxts_fast_fallback(void)
+{
+	if (fs.mode == FS_GUESS) {
+		TRACE_DEV("RXTS calibration: no transition where expected\n");
+		rxts_fast_start(FS_BLIND);
+		return 0;
+	}
+	TRACE_LOG(TRACE_NOTICE,
+		  "RXTS calibration: fast search failed, full scan\n");
+	fs.mode = FS_LINEAR;
+	rxts_linear_start();
+	return 0;
+}
 
-	spll_set_phase_shift(0, cal_cur_phase);
+/*
+ * The flip bit is a square wave over one clock period of phase shift.
+ * Instead of sampling it every CAL_SCAN_STEP, we step by CAL_COARSE_STEP
+ * until it changes, bisect the bracket down to CAL_SCAN_STEP, then skip
+ * to just before the opposite transition, and do the same with shorter
+ * steps.
+ */
+static int rxts_fast_update(uint32_t *t24p_value)
+{
+	int val = rxts_vote();
+	int t, before, skew;
+
+	if (!fs.bisect) {
+		if (fs.expect_val >= 0 && val != fs.expect_val)
+			return rxts_fast_fallback();
+		fs.expect_val = -1;
+
+		if (fs.prev_val < 0 || val == fs.prev_val) {
+			fs.prev_val = val;
+			if (fs.steps_left-- <= 0)
+				return rxts_fast_fallback();
+			rxts_fast_goto(cal_cur_phase + fs.dir * fs.step);
+			return 0;
+		}
+		fs.bisect = 1;
+		fs.old = cal_cur_phase - fs.dir * fs.step;
+		fs.new = cal_cur_phase;
+		fs.old_val = fs.prev_val;
+	} else {
+		/* we are at the middle of the bracket */
+		if (val == fs.old_val)
+			fs.old = cal_cur_phase;
+		else
+			fs.new = cal_cur_phase;
+	}
+
+	if (fs.new - fs.old > CAL_SCAN_STEP || fs.old - fs.new > CAL_SCAN_STEP) {
+		rxts_fast_goto((fs.old + fs.new) / 2);
+		return 0;
+	}
+
+	/* Got one: like the linear scan, report the phase just before it */
+	t = fs.dir > 0 ? fs.old : fs.new;
+	before = fs.dir > 0 ? fs.old_val : !fs.old_val;
+	if (before) {
+		det_falling.trans_phase = t;
+		fs.found |= 2;
+	} else {
+		det_rising.trans_phase = t;
+		fs.found |= 1;
+	}
+
+	if (fs.found == 3) {
+		skew = det_falling.trans_phase - det_rising.trans_phase;
+		if (skew < 0)
+			skew = -skew;
+		skew -= REF_CLOCK_PERIOD_PS / 2;
+		if (skew > CAL_MAX_SKEW || skew < -CAL_MAX_SKEW)
+			return rxts_fast_fallback();
+		return rxts_calibration_done(t24p_value);
+	}
 
+	/* Go on to the other one, that has the opposite polarity */
+	rxts_fast_steps(t + fs.dir * (REF_CLOCK_PERIOD_PS / 2 - CAL_MAX_SKEW),
+			fs.dir, CAL_NEAR_STEP, CAL_NEAR_STEPS,
+			fs.dir > 0 ? !before : before);
 	return 0;
 }
 
+/* Updates RX timestamper state machine. Non-zero return value means that
+   calibration is done. */
+int rxts_calibration_update(uint32_t *t24p_value)
+{
+	if (spll_shifter_busy(0))
+		return 0;
+
+	if (fs.mode == FS_LINEAR)
+		return rxts_linear_update(t24p_value);
+	return rxts_fast_update(t24p_value);
+}
+
 /* legacy function for 'calibration force' command */
 int measure_t24p(uint32_t *value)
 {
@@ -229,6 +467,12 @@ static int calib_t24p_slave(uint32_t *value)
 	int rv;
 	uint32_t prev;
 
+#ifdef CONFIG_CALIB_CACHE
+	if (calib_cache_lookup(value)) {
+		pp_printf("t24p from cache: %d ps\n", *value);
+		return 1;
+	}
+#endif
 	rxts_calibration_start();
 	while (!(rv = rxts_calibration_update(value)))
 		/* FIXME: timeout */;
@@ -247,6 +491,9 @@ static int calib_t24p_slave(uint32_t *value)
 		pp_printf("Wrote new t24p value: %d ps (%s)\n", *value,
 			  rv < 0 ? "Failed" : "Success");
 	}
+#ifdef CONFIG_CALIB_CACHE
+	calib_cache_store(*value);
+#endif
 	return rv;
 }
 
@@ -21,6 +21,7 @@
 
 #define SDBFS_BIG_ENDIAN
 #include <libsdbfs.h>
+#include <nvstate.h>
 
 /*
  * This source file is a drop-in replacement of the legacy one: it manages
@@ -31,6 +32,8 @@
 #define SDB_DEV_MAC	0x6d61632d /* mac- (address) */
 #define SDB_DEV_SFP	0x7366702d /* sfp- (database) */
 #define SDB_DEV_CALIB	0x63616c69 /* cali (bration) */
+#define SDB_DEV_T24P	0x74323470 /* t24p (cache) */
+#define SDB_DEV_STATE	0x77722d73 /* wr-s (tate) */
 
 /* The methods for W1 access */
 static int sdb_w1_read(struct sdbfs *fs, int offset, void *buf, int count)
@@ -94,8 +97,12 @@ uint8_t eeprom_present(uint8_t i2cif, uint8_t i2c_addr)
 	if (magic == SDB_MAGIC) {
 		pp_printf("sdbfs: found at %i in W1\n", entry_points[i]);
 		wrc_sdb.drvdata = &wrpc_w1_bus;
+		wrc_sdb.entrypoint = entry_points[i];
 		wrc_sdb.read = sdb_w1_read;
 		wrc_sdb.write = sdb_w1_write;
+		/* this builds the index that sdbfs_open_id() uses */
+		if (sdbfs_dev_create(&wrc_sdb, 0) < 0)
+			return 0;
 		has_eeprom = 1;
 		eeprom_sdb_list(&wrc_sdb);
 		return 0;
@@ -202,6 +209,19 @@ int32_t eeprom_sfpdb_erase(uint8_t i2cif, uint8_t i2c_addr)
 	return ret == 1 ? 0 : -1;
 }
 
+/* Only the count word, so a bad record 0 doesn't hide the others */
+int32_t eeprom_sfp_count(uint8_t i2cif, uint8_t i2c_addr)
+{
+	uint8_t sfpcount;
+	int ret;
+
+	if (sdbfs_open_id(&wrc_sdb, SDB_VENDOR, SDB_DEV_SFP) < 0)
+		return -1;
+	ret = sdbfs_fread(&wrc_sdb, 0, &sfpcount, sizeof(sfpcount));
+	sdbfs_close(&wrc_sdb);
+	return ret == sizeof(sfpcount) ? sfpcount : -1;
+}
+
 int32_t eeprom_get_sfp(uint8_t i2cif, uint8_t i2c_addr, struct s_sfpinfo * sfp,
 		       uint8_t add, uint8_t pos)
 {
@@ -222,10 +242,14 @@ int32_t eeprom_get_sfp(uint8_t i2cif, uint8_t i2c_addr, struct s_sfpinfo * sfp,
 	    != sizeof(sfpcount))
 		goto out;
 
-	if (add && sfpcount == SFPS_MAX)	//no more space to add new SFPs
-		return EE_RET_DBFULL;
-	if (!pos && !add && sfpcount == 0)	// no SFPs in the database
-		return 0;
+	if (add && sfpcount == SFPS_MAX) {	//no more space to add new SFPs
+		ret = EE_RET_DBFULL;
+		goto out;
+	}
+	if (!pos && !add && sfpcount == 0) {	// no SFPs in the database
+		ret = 0;
+		goto out;
+	}
 
 	if (!add) {
 		if (sdbfs_fread(&wrc_sdb, sizeof(sfpcount) + pos * sizeof(*sfp),
@@ -265,34 +289,6 @@ out:
 	return 0;
 }
 
-int8_t eeprom_match_sfp(uint8_t i2cif, uint8_t i2c_addr, struct s_sfpinfo * sfp)
-{
-	uint8_t sfpcount = 1;
-	int8_t i, temp;
-	struct s_sfpinfo dbsfp;
-
-	for (i = 0; i < sfpcount; ++i) {
-		temp = eeprom_get_sfp(i2cif, i2c_addr,
-				      &dbsfp, 0, i);
-		if (!i) {
-			// first round: valid sfpcount is returned
-			sfpcount = temp;
-			if (sfpcount == 0 || sfpcount == 0xFF)
-				return 0;
-			else if (sfpcount < 0)
-				return sfpcount;
-		}
-		if (!strncmp(dbsfp.pn, sfp->pn, 16)) {
-			sfp->dTx = dbsfp.dTx;
-			sfp->dRx = dbsfp.dRx;
-			sfp->alpha = dbsfp.alpha;
-			return 1;
-		}
-	}
-
-	return 0;
-}
-
 /*
  * Phase transition ("calibration" file)
  */
@@ -303,6 +299,14 @@ int8_t eeprom_phtrans(uint8_t i2cif, uint8_t i2c_addr, uint32_t * valp,
 	int ret = -1;
 	uint32_t value;
 
+#ifdef CONFIG_NVSTATE
+	/* It changes at each calibration: keep it in the state log */
+	if (write && nvstate_set(NV_T24P, valp, sizeof(*valp)) == 0)
+		return 1;
+	if (!write && nvstate_get(NV_T24P, valp, sizeof(*valp)) == sizeof(*valp))
+		return 1;
+	/* no state file, or not saved there yet: use the calibration file */
+#endif
 	if (sdbfs_open_id(&wrc_sdb, SDB_VENDOR, SDB_DEV_CALIB) < 0)
 		return -1;
 	if (write) {
@@ -323,6 +327,55 @@ out:
 	return ret;
 }
 
+#ifdef CONFIG_CALIB_CACHE
+/*
+ * The t24p cache is an array of CAL_CACHE_SLOTS fixed-size entries,
+ * managed by dev/calib-cache.c: here we only read or write one of them.
+ */
+int eeprom_calcache(int slot, struct s_calcache *entry, int write)
+{
+	int ret;
+
+	if (!has_eeprom)
+		return -1;
+	if (slot < 0 || slot >= CAL_CACHE_SLOTS)
+		return EE_RET_POSERR;
+	if (sdbfs_open_id(&wrc_sdb, SDB_VENDOR, SDB_DEV_T24P) < 0)
+		return -1;
+	if (write)
+		ret = sdbfs_fwrite(&wrc_sdb, slot * sizeof(*entry),
+				   entry, sizeof(*entry));
+	else
+		ret = sdbfs_fread(&wrc_sdb, slot * sizeof(*entry),
+				  entry, sizeof(*entry));
+	sdbfs_close(&wrc_sdb);
+	return ret == sizeof(*entry) ? 0 : -1;
+}
+#endif
+
+#ifdef CONFIG_NVSTATE
+/* Same for the state log: dev/nvstate.c decides where to write */
+int eeprom_nvstate(int slot, struct s_nvrec *rec, int write)
+{
+	int ret;
+
+	if (!has_eeprom)
+		return -1;
+	if (slot < 0 || slot >= NV_SLOTS)
+		return EE_RET_POSERR;
+	if (sdbfs_open_id(&wrc_sdb, SDB_VENDOR, SDB_DEV_STATE) < 0)
+		return -1;
+	if (write)
+		ret = sdbfs_fwrite(&wrc_sdb, slot * sizeof(*rec),
+				   rec, sizeof(*rec));
+	else
+		ret = sdbfs_fread(&wrc_sdb, slot * sizeof(*rec),
+				  rec, sizeof(*rec));
+	sdbfs_close(&wrc_sdb);
+	return ret == sizeof(*rec) ? 0 : -1;
+}
+#endif
+
 /*
  * The init script area consist of 2-byte size field and a set of
  * shell commands separated with '\n' character.
@@ -427,6 +480,28 @@ out:
 	return ret;
 }
 
+/* Reads the whole script with one fread; see eeprom.c for the return value */
+int eeprom_init_read(uint8_t i2cif, uint8_t i2c_addr, uint8_t *buf,
+		     int bufsize)
+{
+	uint16_t used;
+	int ret = -1;
+
+	if (sdbfs_open_id(&wrc_sdb, SDB_VENDOR, SDB_DEV_INIT) < 0)
+		return -1;
+	if (sdbfs_fread(&wrc_sdb, 0, &used, sizeof(used)) != sizeof(used))
+		goto out;
+	if (used > 256 /* 0xffff or wrong */)
+		used = 0;
+	if (used && used <= bufsize
+	    && sdbfs_fread(&wrc_sdb, sizeof(used), buf, used) != used)
+		goto out;
+	ret = used;
+out:
+	sdbfs_close(&wrc_sdb);
+	return ret;
+}
+
 int8_t eeprom_init_readcmd(uint8_t i2cif, uint8_t i2c_addr, uint8_t *buf,
 			   uint8_t bufsize, uint8_t next)
 {
@@ -148,6 +148,23 @@ void sdb_print_devices(void)
 	mprintf("---\n");
 }
 
+/*
+ * A signature of the gateware, for what depends on it (the t24p value):
+ * a hash of the top-level SDB records, including the synthesis record
+ * (commit id and date) if the gateware has one.
+ */
+uint32_t sdb_gateware_id(void)
+{
+	sdb_record_t *record = (sdb_record_t *) SDB_ADDRESS;
+	int records = record->interconnect.sdb_records;
+	uint32_t *p = (uint32_t *) record, h = 5381;
+	int i;
+
+	for (i = 0; i < records * sizeof(*record) / sizeof(*p); i++)
+		h = (h << 5) + h + p[i];
+	return h;
+}
+
 void sdb_find_devices(void)
 {
 	BASE_MINIC =         find_device(0xab28633a);
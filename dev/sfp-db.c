@@ -0,0 +1,130 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * A RAM copy of the SFP database. Reading it from the EEPROM (bit-banged
+ * I2C or onewire) takes milliseconds per record, so we do it once at
+ * boot, checking the checksums there, and keep a hash of each part
+ * number. "sfp add" and "sfp erase" write through to the EEPROM.
+ */
+#include <string.h>
+#include <wrc.h>
+
+#include "eeprom.h"
+#include "board.h"
+#include "syscon.h"
+#include "sfp.h"
+
+static struct {
+	int count;
+	uint8_t valid[SFPS_MAX];	/* the checksum was right */
+	uint16_t hash[SFPS_MAX];
+	struct s_sfpinfo sfp[SFPS_MAX];
+} sfp_db;
+
+/* Part numbers are padded with spaces, but may be cut short by a NUL */
+static uint16_t sfp_db_hash(const char *pn)
+{
+	uint16_t h = 5381;
+	int i;
+
+	for (i = 0; i < SFP_PN_LEN && pn[i]; i++)
+		h = (h << 5) + h + pn[i];
+	return h;
+}
+
+static void sfp_db_set(int pos, struct s_sfpinfo *sfp)
+{
+	sfp_db.sfp[pos] = *sfp;
+	sfp_db.hash[pos] = sfp_db_hash(sfp->pn);
+	sfp_db.valid[pos] = 1;
+}
+
+int sfp_db_load(void)
+{
+	struct s_sfpinfo sfp;
+	int i, ret;
+
+	sfp_db.count = 0;
+	ret = eeprom_sfp_count(WRPC_FMC_I2C, FMC_EEPROM_ADR);
+	if (ret < 0)
+		pp_printf("sfp: can't read the database\n");
+	if (ret <= 0 || ret > SFPS_MAX) /* empty, erased (0xff) or error */
+		return 0;
+	sfp_db.count = ret;
+	for (i = 0; i < sfp_db.count; i++) {
+		sfp_db.valid[i] = 0;
+		ret = eeprom_get_sfp(WRPC_FMC_I2C, FMC_EEPROM_ADR, &sfp, 0, i);
+		if (ret < 0) {
+			pp_printf("sfp: record %d corrupted\n", i + 1);
+			continue;
+		}
+		sfp_db_set(i, &sfp);
+	}
+	return sfp_db.count;
+}
+
+int sfp_db_count(void)
+{
+	return sfp_db.count;
+}
+
+/* Returns the record, or NULL if it was corrupted */
+struct s_sfpinfo *sfp_db_get(int pos)
+{
+	if (pos < 0 || pos >= sfp_db.count || !sfp_db.valid[pos])
+		return NULL;
+	return sfp_db.sfp + pos;
+}
+
+/* Fills deltas and alpha of sfp from its part number: 1 if found */
+int sfp_db_match(struct s_sfpinfo *sfp)
+{
+	uint16_t h = sfp_db_hash(sfp->pn);
+	struct s_sfpinfo *dbsfp;
+	int i;
+
+	for (i = 0; i < sfp_db.count; i++) {
+		if (!sfp_db.valid[i] || sfp_db.hash[i] != h)
+			continue;
+		dbsfp = sfp_db.sfp + i;
+		if (strncmp(dbsfp->pn, sfp->pn, SFP_PN_LEN))
+			continue;
+		sfp->dTx = dbsfp->dTx;
+		sfp->dRx = dbsfp->dRx;
+		sfp->alpha = dbsfp->alpha;
+		return 1;
+	}
+	return 0;
+}
+
+/* Returns the new count or an EE_RET_ error, like eeprom_get_sfp() */
+int sfp_db_add(struct s_sfpinfo *sfp)
+{
+	int i, ret;
+
+	if (sfp_db.count == SFPS_MAX)
+		return EE_RET_DBFULL;
+	ret = eeprom_get_sfp(WRPC_FMC_I2C, FMC_EEPROM_ADR, sfp, 1, 0);
+	if (ret <= 0 || ret > SFPS_MAX)
+		return ret < 0 ? ret : EE_RET_I2CERR;
+	/* The EEPROM may have had more than we know, if we failed at boot */
+	for (i = sfp_db.count; i < ret - 1; i++)
+		sfp_db.valid[i] = 0;
+	sfp_db.count = ret;
+	sfp_db_set(ret - 1, sfp);
+	return ret;
+}
+
+int sfp_db_erase(void)
+{
+	int ret;
+
+	ret = eeprom_sfpdb_erase(WRPC_FMC_I2C, FMC_EEPROM_ADR);
+	if (ret >= 0)
+		sfp_db.count = 0;
+	return ret;
+}
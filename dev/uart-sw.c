@@ -42,6 +42,32 @@ void uart_sw_write_byte(int b)
 	usleep(1000 * 1000 / 11520);
 }
 
+/*
+ * For the console buffer: no delay, but no more than the host can
+ * read at 115200 baud, so we count characters per timer tic.
+ */
+#define UART_SW_PER_TIC (11520 / TICS_PER_SECOND + 1)
+
+int uart_sw_try_write_raw(int b)
+{
+	static uint32_t tics;
+	static int count;
+	int index;
+
+	if (timer_get_tics() != tics) {
+		tics = timer_get_tics();
+		count = 0;
+	}
+	if (count == UART_SW_PER_TIC)
+		return -1;
+	count++;
+	index = uart_sw_dev.nwritten % CONFIG_UART_SW_WSIZE;
+	uart_sw_dev.wbuffer[index] = b;
+	uart_sw_dev.nwritten++;
+	return 0;
+}
+
+#ifndef CONFIG_CONSOLE_BUF /* otherwise console.c has it */
 int uart_sw_write_string(const char *s)
 {
 	const char *t = s;
@@ -49,6 +75,12 @@ int uart_sw_write_string(const char *s)
 		uart_sw_write_byte(*(s++));
 	return s - t;
 }
+#endif
+
+int uart_sw_rx_ready(void)
+{
+	return nreturned != uart_sw_dev.nread;
+}
 
 int uart_sw_read_byte()
 {
@@ -62,12 +94,16 @@ int uart_sw_read_byte()
 }
 
 /* alias the "hw" names to these, so this applies if !CONFIG_UART */
+#ifndef CONFIG_CONSOLE_BUF
 int puts(const char *s)
 	__attribute__((alias("uart_sw_write_string"), weak));
-void uart_write_byte(int b)
-	__attribute__((alias("uart_sw_write_byte"), weak));
 int uart_write_string(const char *s)
 	__attribute__((alias("uart_sw_write_string"), weak));
+#endif
+void uart_write_byte(int b)
+	__attribute__((alias("uart_sw_write_byte"), weak));
 int uart_read_byte()
 	__attribute__((alias("uart_sw_read_byte"), weak));
+int uart_rx_ready(void)
+	__attribute__((alias("uart_sw_rx_ready"), weak));
 
@@ -46,22 +46,33 @@ int uart_write_string(const char *s)
 	return s - t;
 }
 
-static int uart_poll()
+/* Non-blocking and raw (no \r added): returns -1 if the uart is busy */
+int uart_try_write_raw(int b)
+{
+	if (uart->SR & UART_SR_TX_BUSY)
+		return -1;
+	uart->TDR = b;
+	return 0;
+}
+
+int uart_rx_ready(void)
 {
 	return uart->SR & UART_SR_RX_RDY;
 }
 
 int uart_read_byte()
 {
-	if (!uart_poll())
+	if (!uart_rx_ready())
 		return -1;
 
 	return uart->RDR & 0xff;
 }
 
+#ifndef CONFIG_CONSOLE_BUF /* otherwise console.c has them */
 int puts(const char *s)
 	__attribute__((alias("uart_write_string")));
 
 /* The next alias is for ppsi log messages, that go to sw_uart if built */
 int uart_sw_write_string(const char *s)
 	__attribute__((alias("uart_write_string"), weak));
+#endif
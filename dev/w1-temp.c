@@ -2,15 +2,37 @@
  * Temperature input for DS18S20 (family 0x10)
  * Alessandro Rubini, 2013 GNU GPL2 or later
  */
+#include <string.h>
 #include <wrc.h>
+#include <task.h>
 #include <w1.h>
 
+static int32_t w1_temp_decode(int class, uint8_t *scratchpad)
+{
+	int32_t res = 0;
+	int16_t cval = scratchpad[1] << 8 | scratchpad[0];
+
+	switch(class) {
+	case 0x10:
+		/* 18S20: two bytes plus "count remain" value */
+		res = (int32_t)cval << 15; /* 1 decimal points */
+		res -= 0x4000; /* - 0.25 degrees */
+		res |= scratchpad[6] << 12; /* 1/16th of degree each */
+		break;
+
+	case 0x28:
+	case 0x42:
+		/* 18B20 and DS28EA00: only the two bytes */
+		res = (int32_t)cval << 12; /* 4 decimal points */
+		break;
+	}
+	return res;
+}
+
 int32_t w1_read_temp(struct w1_dev *dev, unsigned long flags)
 {
 	static uint8_t scratchpad[8];
 	int class = w1_class(dev);
-	int32_t res;
-	int16_t cval;
 	int i;
 
 	/* The caller is expected to have checked the class. but still... */
@@ -40,24 +62,7 @@ collect:
 	for (i = 0; i < sizeof(scratchpad); i++)
 		scratchpad[i] = w1_read_byte(dev->bus);
 
-	res = 0;
-	cval = scratchpad[1] << 8 | scratchpad[0];
-
-	switch(class) {
-	case 0x10:
-		/* 18S20: two bytes plus "count remain" value */
-		res = (int32_t)cval << 15; /* 1 decimal points */
-		res -= 0x4000; /* - 0.25 degrees */
-		res |= scratchpad[6] << 12; /* 1/16th of degree each */
-		break;
-
-	case 0x28:
-	case 0x42:
-		/* 18B20 and DS28EA00: only the two bytes */
-		res = (int32_t)cval << 12; /* 4 decimal points */
-		break;
-	}
-	return res;
+	return w1_temp_decode(class, scratchpad);
 }
 
 int32_t w1_read_temp_bus(struct w1_bus *bus, unsigned long flags)
@@ -76,3 +81,199 @@ int32_t w1_read_temp_bus(struct w1_bus *bus, unsigned long flags)
 	/* not found */
 	return 1 << 31;
 }
+
+/*
+ * The background engine. For each sensor in turn: send "convert" (with
+ * match rom), poll one bit slot per call until the sensor releases the
+ * bus, then read the scratchpad and check its CRC. Transfers are split
+ * in W1T_BITS slots per call (a slot is 70us or so, a reset 1ms).
+ * Other users of the bus (eeprom, nvstate, calib-cache) may come in
+ * between and break our transaction: they bump bus->gen, and then we
+ * start again with "convert", or we could read a stale scratchpad.
+ */
+#define W1T_BITS	8
+#define W1T_PERIOD	TICS_PER_SECOND		/* between rounds */
+#define W1T_TIMEOUT	(TICS_PER_SECOND * 3 / 2) /* 750ms is the max */
+
+enum {W1T_IDLE, W1T_CONVERT, W1T_WAIT, W1T_READ};
+
+static struct {
+	struct w1_bus *bus;
+	int n, cur, state;
+	struct w1_temp sensors[W1_MAX_DEVICES];
+	/* the current transfer: a reset, tx bytes then rx bytes */
+	uint8_t tx[10], rx[9];
+	int ntx, nrx, pos;
+	uint32_t t0, last, round;
+	unsigned gen;		/* bus->gen when we sent "convert" */
+} w1t;
+
+static int w1t_is_temp(struct w1_dev *d)
+{
+	switch(w1_class(d)) {
+	case 0x10: case 0x28: case 0x42:
+		return 1;
+	}
+	return 0;
+}
+
+void w1_temp_init(struct w1_bus *bus)
+{
+	int i;
+
+	memset(&w1t, 0, sizeof(w1t));
+	w1t.bus = bus;
+	for (i = 0; i < W1_MAX_DEVICES; i++) {
+		if (!w1t_is_temp(bus->devs + i))
+			continue;
+		w1t.sensors[w1t.n].dev = bus->devs + i;
+		w1t.sensors[w1t.n].value = W1_TEMP_NONE;
+		w1t.n++;
+	}
+}
+
+int w1_temp_count(void)
+{
+	return w1t.n;
+}
+
+int32_t w1_temp_get(int index, uint32_t *tics)
+{
+	if (index >= w1t.n)
+		return W1_TEMP_NONE;
+	if (tics)
+		*tics = w1t.sensors[index].tics;
+	return w1t.sensors[index].value;
+}
+
+static void w1t_start(int cmd, int nrx)
+{
+	uint64_t rom = w1t.sensors[w1t.cur].dev->rom;
+	int i;
+
+	w1t.tx[0] = W1_CMD_MATCH_ROM;
+	for (i = 0; i < 8; i++)
+		w1t.tx[i + 1] = rom >> (8 * i);
+	w1t.tx[9] = cmd;
+	w1t.ntx = 10;
+	w1t.nrx = nrx;
+	memset(w1t.rx, 0, sizeof(w1t.rx));
+	w1t.pos = -1; /* reset first */
+}
+
+/* Returns 1 when done, 0 if more is needed, -1 if nobody answers */
+static int w1t_xfer(void)
+{
+	struct w1_bus *bus = w1t.bus;
+	int i, pos;
+
+	if (w1t.pos < 0) {
+		if (wrpc_w1_ops.reset(bus) != 1)
+			return -1;
+		w1t.pos = 0;
+		return 0;
+	}
+	for (i = 0; i < W1T_BITS; i++, w1t.pos++) {
+		pos = w1t.pos;
+		if (pos < w1t.ntx * 8) {
+			wrpc_w1_ops.write_bit(bus,
+					      (w1t.tx[pos >> 3] >> (pos & 7)) & 1);
+			continue;
+		}
+		pos -= w1t.ntx * 8;
+		if (pos >= w1t.nrx * 8)
+			return 1;
+		if (wrpc_w1_ops.read_bit(bus))
+			w1t.rx[pos >> 3] |= 1 << (pos & 7);
+	}
+	return w1t.pos == (w1t.ntx + w1t.nrx) * 8;
+}
+
+/* Dallas/Maxim CRC-8 (x^8 + x^5 + x^4 + 1): 0 over data and crc */
+static uint8_t w1t_crc8(uint8_t *buf, int len)
+{
+	uint8_t crc = 0;
+	int i, j;
+
+	for (i = 0; i < len; i++) {
+		crc ^= buf[i];
+		for (j = 0; j < 8; j++)
+			crc = crc & 1 ? (crc >> 1) ^ 0x8c : crc >> 1;
+	}
+	return crc;
+}
+
+static void w1t_next(void)
+{
+	w1t.state = W1T_IDLE;
+	if (++w1t.cur == w1t.n)
+		w1t.cur = 0;
+}
+
+void w1_temp_poll(void)
+{
+	struct w1_temp *s = w1t.sensors + w1t.cur;
+	int ret;
+
+	if (w1t.state != W1T_IDLE && w1t.bus->gen != w1t.gen) {
+		/* Somebody else used the bus: this sensor again */
+		w1t_start(W1_CMDT_CONVERT, 0);
+		w1t.gen = w1t.bus->gen;
+		w1t.state = W1T_CONVERT;
+		return;
+	}
+
+	switch (w1t.state) {
+	case W1T_IDLE:
+		if (!w1t.n)
+			return;
+		if (!w1t.cur) {
+			if (time_before(timer_get_tics(), w1t.round))
+				return;
+			w1t.round = timer_get_tics() + W1T_PERIOD;
+		}
+		w1t_start(W1_CMDT_CONVERT, 0);
+		w1t.gen = w1t.bus->gen;
+		w1t.state = W1T_CONVERT;
+		return;
+
+	case W1T_CONVERT:
+		ret = w1t_xfer();
+		if (ret < 0)
+			w1t_next();
+		if (ret <= 0)
+			return;
+		w1t.t0 = timer_get_tics();
+		w1t.state = W1T_WAIT;
+		return;
+
+	case W1T_WAIT:
+		/* The sensor sends 0 while converting: check once per tic */
+		if (timer_get_tics() == w1t.last)
+			return;
+		w1t.last = timer_get_tics();
+		if (!wrpc_w1_ops.read_bit(w1t.bus)
+		    && time_before(timer_get_tics(), w1t.t0 + W1T_TIMEOUT))
+			return;
+		w1t_start(W1_CMDT_R_SPAD, sizeof(w1t.rx));
+		w1t.state = W1T_READ;
+		return;
+
+	case W1T_READ:
+		ret = w1t_xfer();
+		if (ret == 0)
+			return;
+		if (ret > 0 && !w1t_crc8(w1t.rx, sizeof(w1t.rx))) {
+			s->value = w1_temp_decode(w1_class(s->dev), w1t.rx);
+			s->tics = timer_get_tics();
+		}
+		w1t_next();
+		return;
+	}
+}
+
+DEFINE_WRC_TASK(w1_temp, 5) = {
+	.name = "w1-temp",
+	.job = w1_temp_poll,
+	.period = 10,
+};
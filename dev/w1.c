@@ -4,7 +4,6 @@
  */
 #include <string.h>
 #include <w1.h>
-#include <unistd.h>
 
 static const struct w1_ops *ops = &wrpc_w1_ops; /* local shorter name */
 
@@ -22,9 +21,7 @@ int w1_read_byte(struct w1_bus *bus)
 
 	for (i = 1; i < 0x100; i <<= 1)
 		res |= ops->read_bit(bus) ? i : 0;
-	usleep(100); /* inter-byte, for my eyes only */
 	return res;
-
 }
 
 /* scan_bus requires this di-bit helper */
@@ -56,6 +53,7 @@ static int __w1_scan_one(struct w1_bus *bus, uint64_t *rom, uint64_t *cmask)
 	int select;
 	enum __bits b;
 
+	bus->gen++;
 	if (ops->reset(bus) != 1)
 		return -1;
 	w1_write_byte(bus, 0xf0); /* search rom */
@@ -137,6 +135,7 @@ void w1_match_rom(struct w1_dev *dev)
 {
 	int i;
 
+	dev->bus->gen++;
 	ops->reset(dev->bus);
 	w1_write_byte(dev->bus, W1_CMD_MATCH_ROM); /* match rom */
 	for (i = 0; i < 64; i+=8) {
@@ -0,0 +1,14 @@
+#ifndef __CONSOLE_H__
+#define __CONSOLE_H__
+
+/*
+ * Buffered console output (CONFIG_CONSOLE_BUF): puts() only copies to
+ * RAM, and console_poll() feeds the uart at its own pace. If the
+ * buffer is full, characters are dropped and counted, unless blocking
+ * is allowed (the shell allows it while running a command).
+ */
+void console_poll(void);
+void console_flush(void);
+void console_set_blocking(int block);
+
+#endif /* __CONSOLE_H__ */
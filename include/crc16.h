@@ -0,0 +1,9 @@
+#ifndef __CRC16_H__
+#define __CRC16_H__
+
+#include <stdint.h>
+
+/* CRC-16/CCITT (polynomial 0x1021), start with 0xffff */
+uint16_t crc16(uint16_t crc, const void *buf, int len);
+
+#endif /* __CRC16_H__ */
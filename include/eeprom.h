@@ -27,19 +27,51 @@ struct s_sfpinfo {
 	uint8_t chksum;
 } __attribute__ ((__packed__));
 
+/* One entry of the t24p cache ("t24p-cache" sdbfs file) */
+#define CAL_CACHE_SLOTS 6
+
+struct s_calcache {
+	char pn[SFP_PN_LEN];
+	uint32_t gw;		/* sdb_gateware_id() */
+	uint16_t stamp;		/* the oldest is replaced first */
+	int8_t temp;		/* temperature bucket */
+	uint32_t t24p;
+	int32_t dTx;
+	int32_t dRx;
+	int32_t alpha;
+	uint8_t chksum;		/* complement of the sum of all other bytes */
+} __attribute__ ((__packed__));
+
+/* One record of the state log ("wr-state" sdbfs file), see nvstate.c */
+#define NV_SLOTS	32
+#define NV_DATA_LEN	8
+
+struct s_nvrec {
+	uint32_t seq;		/* 0 and ~0 are never used */
+	uint8_t key;
+	uint8_t len;
+	uint16_t crc;		/* crc16 of the other fields */
+	uint8_t data[NV_DATA_LEN];
+} __attribute__ ((__packed__));
+
 uint8_t eeprom_present(uint8_t i2cif, uint8_t i2c_addr);
 
 int32_t eeprom_sfpdb_erase(uint8_t i2cif, uint8_t i2c_addr);
+int32_t eeprom_sfp_count(uint8_t i2cif, uint8_t i2c_addr);
 int32_t eeprom_sfp_section(uint8_t i2cif, uint8_t i2c_addr, size_t size,
 			   uint16_t * section_sz);
-int8_t eeprom_match_sfp(uint8_t i2cif, uint8_t i2c_addr, struct s_sfpinfo *sfp);
 
 int8_t eeprom_phtrans(uint8_t i2cif, uint8_t i2c_addr, uint32_t * val,
 		      uint8_t write);
 
+int eeprom_calcache(int slot, struct s_calcache *entry, int write);
+int eeprom_nvstate(int slot, struct s_nvrec *rec, int write);
+
 int8_t eeprom_init_erase(uint8_t i2cif, uint8_t i2c_addr);
 int8_t eeprom_init_add(uint8_t i2cif, uint8_t i2c_addr, const char *args[]);
 int32_t eeprom_init_show(uint8_t i2cif, uint8_t i2c_addr);
+int eeprom_init_read(uint8_t i2cif, uint8_t i2c_addr, uint8_t *buf,
+		     int bufsize);
 int8_t eeprom_init_readcmd(uint8_t i2cif, uint8_t i2c_addr, uint8_t *buf,
 			   uint8_t bufsize, uint8_t next);
 
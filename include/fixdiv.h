@@ -0,0 +1,64 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#ifndef __FIXDIV_H__
+#define __FIXDIV_H__
+
+#include <stdint.h>
+
+/*
+ * Division by constants, without the libgcc divide routines: the lm32
+ * has no divider, so __udivdi3 and friends loop bit by bit.
+ *
+ * For a constant d > 1, l = ceil(log2(d)), S = 31 + l and
+ * M = ceil(2^S / d), we have u / d == (u * M) >> S for any u < 2^31
+ * (Granlund and Montgomery, "Division by invariant integers using
+ * multiplication", 1994). M is less than 2^32, so the product fits
+ * 64 bits. All of M and S is computed by the compiler, as long as
+ * d is a constant: these are macros so that happens even with -Os.
+ *
+ * Arguments that don't fit the limits above produce a reference to
+ * __fixdiv_bad_divisor(), which doesn't exist: the link fails.
+ */
+extern uint32_t __fixdiv_bad_divisor(void);
+
+#define FIXDIV_L(d)	(32 - __builtin_clz((uint32_t)(d) - 1))
+#define FIXDIV_S(d)	(31 + FIXDIV_L(d))
+#define FIXDIV_M(d)	((uint32_t)(((1ULL << FIXDIV_S(d)) + (d) - 1) / (d)))
+
+/* u / d, for u < 2^31 and 1 < d < 2^31 */
+#define FIXDIV(u, d)						\
+	((d) < 2 || (d) >= (1U << 31) ? __fixdiv_bad_divisor() :	\
+	 (uint32_t)(((uint64_t)(uint32_t)(u) * FIXDIV_M(d))		\
+		    >> FIXDIV_S(d)))
+
+/*
+ * u * a / b, rounded down, without a 64-bit product nor a divide:
+ * split u = q * b + r and compute q * a + r * a / b. The powers of
+ * two common to a and b are removed first, and (b - 1) * a must
+ * then be less than 2^31. The result must fit 32 bits, as usual.
+ */
+#define __FIXDIV_TZ(a, b) (__builtin_ctz(a) < __builtin_ctz(b) ?	\
+			   __builtin_ctz(a) : __builtin_ctz(b))
+#define __FIXDIV_A(a, b) ((uint32_t)(a) >> __FIXDIV_TZ(a, b))
+#define __FIXDIV_B(a, b) ((uint32_t)(b) >> __FIXDIV_TZ(a, b))
+
+#define FIXMULDIV(u, a, b) ({					\
+	uint32_t __u = (u), __q;					\
+	if ((uint64_t)(__FIXDIV_B(a, b) - 1) * __FIXDIV_A(a, b)	\
+	    >= (1U << 31))						\
+		__fixdiv_bad_divisor();					\
+	if (__FIXDIV_B(a, b) == 1) {					\
+		__q = __u * __FIXDIV_A(a, b);				\
+	} else {							\
+		__q = FIXDIV(__u, __FIXDIV_B(a, b));			\
+		__q = __q * __FIXDIV_A(a, b) +				\
+			FIXDIV((__u - __q * __FIXDIV_B(a, b))		\
+			       * __FIXDIV_A(a, b), __FIXDIV_B(a, b));	\
+	}								\
+	__q;								\
+})
+
+#endif /* __FIXDIV_H__ */
@@ -1,6 +1,8 @@
 #ifndef __REGS_H
 #define __REGS_H
 
+#include <stdint.h>
+
 #define SDB_ADDRESS 0x30000
 
 extern unsigned char *BASE_MINIC;
@@ -16,5 +18,6 @@ extern unsigned char *BASE_ETHERBONE_CFG;
 
 void sdb_find_devices(void);
 void sdb_print_devices(void);
+uint32_t sdb_gateware_id(void);
 
 #endif
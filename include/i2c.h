@@ -10,6 +10,7 @@ void mi2c_get_byte(uint8_t i2cif, unsigned char *data, uint8_t last);
 unsigned char mi2c_put_byte(uint8_t i2cif, unsigned char data);
 
 void mi2c_delay();
+void mi2c_set_speed(int khz);
 //void mi2c_scan(uint8_t i2cif);
 
 #endif
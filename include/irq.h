@@ -10,4 +10,19 @@ static inline void clear_irq()
 void disable_irq();
 void enable_irq();
 
+/* For short critical sections: clear IE and return the previous value */
+static inline unsigned int irq_save(void)
+{
+	unsigned int ie;
+
+	asm volatile ("rcsr %0, ie":"=r" (ie));
+	asm volatile ("wcsr ie, %0"::"r" (ie & ~1));
+	return ie;
+}
+
+static inline void irq_restore(unsigned int ie)
+{
+	asm volatile ("wcsr ie, %0"::"r" (ie));
+}
+
 #endif
@@ -0,0 +1,25 @@
+#ifndef __NVSTATE_H__
+#define __NVSTATE_H__
+
+/*
+ * Runtime state kept across resets, in a log of records in the
+ * "wr-state" sdbfs file. Values are set in RAM and written later,
+ * at most one record per second, each key no more often than its
+ * own period.
+ */
+enum nv_key {
+	NV_UPTIME,		/* seconds, summed over all boots */
+	NV_DELOCKS,		/* SoftPLL delocks, summed over all boots */
+	NV_DAC,			/* main DAC when last locked */
+	NV_T24P,		/* see eeprom_phtrans() */
+	NV_KEYS
+};
+
+void nvstate_init(void);
+void nvstate_poll(void);
+int nvstate_get(int key, void *buf, int len);
+int nvstate_set(int key, const void *buf, int len);
+int nvstate_erase(void);
+void nvstate_show(void);
+
+#endif /* __NVSTATE_H__ */
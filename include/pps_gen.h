@@ -24,6 +24,9 @@ int shw_pps_gen_enable_output(int enable);
 /* Reads the current time and stores at <seconds,nanoseconds>. */
 void shw_pps_gen_get_time(uint64_t * seconds, uint32_t * nanoseconds);
 
+/* Same, but returns reference clock cycles; the seconds are cached */
+void shw_pps_gen_get_time_cycles(uint64_t * seconds, uint32_t * cycles);
+
 /* Sets the time to <seconds,nanoseconds>. */
 void shw_pps_gen_set_time(uint64_t seconds, uint32_t nanoseconds, int counter);
 
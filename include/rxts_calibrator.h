@@ -10,9 +10,29 @@
 #ifndef __RXTS_CALIBRATOR_H
 #define __RXTS_CALIBRATOR_H
 
+extern int rxts_cal_linear;
+
+/* The last calibration: how it went and how long it took */
+struct rxts_cal_stats {
+	int linear;		/* the fast search fell back or wasn't used */
+	uint32_t scan_ms;	/* from rxts_calibration_start() */
+	uint32_t link_ms;	/* from link up */
+};
+extern struct rxts_cal_stats rxts_cal_stats;
+
+void rxts_link_up(void);
+
 void rxts_calibration_start();
-int rxts_calibration_update(int *t24p_value);
+int rxts_calibration_update(uint32_t *t24p_value);
 int measure_t24p(uint32_t *value);
 int calib_t24p(int mode, uint32_t *value);
 
+/* dev/calib-cache.c */
+void calib_cache_init(void);
+int calib_cache_lookup(uint32_t *t24p);
+void calib_cache_store(uint32_t t24p);
+void calib_cache_drop(int slot);
+void calib_cache_poll(void);
+void calib_cache_show(void);
+
 #endif
@@ -11,4 +11,13 @@ int sfp_present();
 /* Reads the part ID of the SFP from its configuration EEPROM */
 int sfp_read_part_id(char *part_id);
 
+/* RAM copy of the SFP database in EEPROM (dev/sfp-db.c) */
+struct s_sfpinfo;
+int sfp_db_load(void);
+int sfp_db_count(void);
+struct s_sfpinfo *sfp_db_get(int pos);
+int sfp_db_match(struct s_sfpinfo *sfp);
+int sfp_db_add(struct s_sfpinfo *sfp);
+int sfp_db_erase(void);
+
 #endif
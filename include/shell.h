@@ -9,6 +9,8 @@ extern int wrc_ui_mode;
 
 const char *fromhex(const char *hex, int *v);
 const char *fromdec(const char *dec, int *v);
+void decode_ip(const char *str, unsigned char *ip);
+void decode_mac(const char *str, unsigned char *mac);
 
 struct wrc_shell_cmd {
 	char *name;
@@ -0,0 +1,55 @@
+#ifndef __STAT_BIN_H__
+#define __STAT_BIN_H__
+
+#include <stdint.h>
+
+/*
+ * Binary form of the "stat" line, printed by "stat bin". Each record
+ * is sent as one console line: STAT_BIN_START and the record in base64
+ * (so the line can go through the console and the terminal like
+ * text). All fields are big-endian (the lm32 byte order), and the crc
+ * (see crc16.h) covers all of the record before it.
+ * This header is shared with tools/wrpc-stat.c
+ */
+#define STAT_BIN_MAGIC		0x5753	/* "WS" */
+#define STAT_BIN_VERSION	1
+#define STAT_BIN_START		'~'
+
+#define STAT_F_LINK_UP		0x01
+#define STAT_F_PLL_LOCKED	0x02
+#define STAT_F_SERVO_VALID	0x04
+
+struct stat_rec {
+	uint16_t magic;
+	uint8_t version;
+	uint8_t flags;
+	uint32_t seq;		/* incremented for every record */
+	uint32_t rx, tx;	/* frames */
+	uint32_t aux;		/* spll_get_aux_status(0) */
+	uint32_t sec;		/* WR time (low 32 bits) */
+	uint32_t nsec;
+	int64_t mu;		/* picoseconds */
+	int64_t delay_ms;	/* picoseconds */
+	int32_t delta_tx_m, delta_rx_m;
+	int32_t delta_tx_s, delta_rx_s;
+	int32_t asymmetry;
+	int32_t cur_offset;
+	int32_t cur_setpoint;
+	int32_t dac_hpll, dac_main, dac_aux;
+	uint32_t update_count;
+	int32_t temp;		/* Celsius, 16.16 fixed point */
+	char servo_state[16];	/* not terminated if 16 characters long */
+	uint16_t crc;
+} __attribute__((packed));
+
+/* base64 length of the record, without the start character */
+#define STAT_BIN_LEN	((sizeof(struct stat_rec) + 2) / 3 * 4)
+
+#ifdef __lm32__
+extern int wrc_stat_bin;
+
+void stat_bin_send(struct stat_rec *r);
+void wrc_log_stats_bin(void);
+#endif
+
+#endif /* __STAT_BIN_H__ */
@@ -0,0 +1,77 @@
+#ifndef __TASK_H__
+#define __TASK_H__
+
+#include <stdint.h>
+
+/*
+ * The main loop is a run-to-completion scheduler: each subsystem
+ * registers its jobs with DEFINE_WRC_TASK and task_run() calls them in
+ * priority order. A job must return quickly; it is called every pass,
+ * every "period" milliseconds, when one of its "events" happened or
+ * when woken by task_wake(), and the time it takes is checked against
+ * its budget. When no job is due, the loop waits in task_idle().
+ */
+#define TASK_LINK	0x01	/* only run when the link is up */
+#define TASK_EVENT	0x02	/* only run when woken (or at the period) */
+
+#define TASK_BUDGET	10	/* ms, the default budget */
+
+/*
+ * Events, sampled at each pass and, while the loop waits in idle, by
+ * the softpll interrupt. The idle loop only reads RAM, so it doesn't
+ * compete for the bus; the interrupt only looks at the devices while
+ * "task_waiting" is set, so it costs nothing while jobs run.
+ */
+#define EV_RX		0x01	/* the minic has a frame */
+#define EV_UART		0x02	/* a character was received */
+
+#define TASK_IDLE_MAX	100	/* ms, the longest wait in idle */
+#define TASK_IDLE_SPINS	10000	/* about 1ms, in case irqs are off */
+
+struct wrc_task {
+	char *name;
+	void (*job)(void);
+	int period;		/* ms, 0 for every pass */
+	int budget;		/* ms, 0 for TASK_BUDGET */
+	int flags;
+	int events;		/* EV_ bits that make it run */
+	/* run time state and statistics */
+	int pending;
+	uint32_t next;		/* tics */
+	uint32_t nrun, noverrun;
+	uint32_t max_tics, total_tics;
+};
+extern struct wrc_task __task_begin[], __task_end[];
+
+/*
+ * Put the structures in their own section: the section name carries
+ * the priority (one digit, 0 first), and the linker sorts them. The
+ * order of tasks with the same priority is not defined.
+ */
+#define DEFINE_WRC_TASK(_name, _prio) \
+	struct wrc_task __wrc_task_ ## _name \
+	__attribute__((section(".task." #_prio), __used__))
+
+#define WRC_TASK(_name) (&__wrc_task_ ## _name)
+
+extern int wrc_link_up;
+
+struct task_idle_stats {
+	uint32_t start;		/* tics, when the statistics were cleared */
+	uint32_t idle;		/* tics spent waiting since then */
+	uint32_t last_pct;	/* idle percentage in the last second */
+};
+extern struct task_idle_stats task_idle_stats;
+
+static inline void task_wake(struct wrc_task *t)
+{
+	t->pending = 1;
+}
+
+extern volatile int task_waiting;
+
+void task_sample_events(void);
+void task_run(void);
+void task_clear_stats(void);
+
+#endif /* __TASK_H__ */
@@ -0,0 +1,55 @@
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdint.h>
+
+/*
+ * Binary telemetry record, sent as the payload of one UDP datagram.
+ * All fields are big-endian (the lm32 byte order). The layout is fixed
+ * for a given version: new fields are only appended, and the version
+ * bumped, so a decoder can accept records longer than it knows.
+ * This header is shared with tools/wrpc-telemetry.c
+ */
+#define TELEMETRY_MAGIC		0x5754	/* "WT" */
+#define TELEMETRY_VERSION	1
+#define TELEMETRY_PORT		22356
+
+#define TELEMETRY_F_SERVO_VALID	0x01
+#define TELEMETRY_F_PLL_LOCKED	0x02
+#define TELEMETRY_F_PTRACK_EN	0x04
+
+struct telemetry_rec {
+	uint16_t magic;
+	uint8_t version;
+	uint8_t flags;
+	uint32_t seq;		/* incremented for every record sent */
+	uint32_t sec;		/* WR time of the sample (low 32 bits) */
+	uint32_t nsec;
+	int64_t mu;		/* picoseconds */
+	int64_t delay_ms;	/* picoseconds */
+	int32_t cur_offset;
+	int32_t cur_setpoint;
+	int32_t cur_skew;
+	uint32_t update_count;
+	int32_t dac_hpll;
+	int32_t dac_main;
+	int32_t dac_aux;
+	int32_t ptrack_phase;	/* picoseconds */
+	int32_t temp;		/* Celsius, 16.16 fixed point */
+} __attribute__((packed));
+
+#ifdef __lm32__
+/* Firmware side: collector settings, changed by the "telemetry" command */
+struct telemetry_cfg {
+	int enabled;
+	uint8_t ip[4];
+	uint8_t mac[6];
+	int port;
+	int period;		/* ms; 0 means every servo update */
+};
+extern struct telemetry_cfg telemetry_cfg;
+
+void telemetry_poll(void);
+#endif
+
+#endif /* __TELEMETRY_H__ */
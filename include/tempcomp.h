@@ -0,0 +1,25 @@
+#ifndef __TEMPCOMP_H__
+#define __TEMPCOMP_H__
+
+#include <stdint.h>
+
+/*
+ * Temperature compensation of the fixed delays: a running fit of the
+ * round-trip delay against the onewire temperature. The correction is
+ * split between delta_tx and delta_rx, as returned by ep_get_deltas().
+ */
+struct tempcomp {
+	int enabled;		/* apply the correction */
+	int32_t ref;		/* temperature of the SFP deltas, 1/256 C */
+	int32_t dtx, drx;	/* what ep_get_deltas() adds, ps */
+};
+
+#define TEMPCOMP_NO_REF	((int32_t)0x80000000) /* use the first sample */
+
+extern struct tempcomp tempcomp;
+
+void tempcomp_poll(void);
+void tempcomp_reset(void);
+void tempcomp_show(void);
+
+#endif /* __TEMPCOMP_H__ */
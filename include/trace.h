@@ -1,15 +1,55 @@
 #ifndef __FREESTANDING_TRACE_H__
 #define __FREESTANDING_TRACE_H__
 
+/*
+ * The "subsys" argument of wrc_debug_printf(): a severity in the low
+ * bits (TRACE_DEV is TRACE_DEBUG) and subsystem bits. TRACE_LOG()
+ * passes a severity; the syslog sink maps it (see wrc_main.c), and
+ * warnings and errors are also printed on the UART.
+ */
+#define TRACE_SEV_MASK	0x07
+#define TRACE_DEBUG	0
+#define TRACE_INFO	1
+#define TRACE_NOTICE	2
+#define TRACE_WARNING	3
+#define TRACE_ERR	4
+
+#define TRACE_SERVO	(1 << 5)	/* printed on the UART */
+
 #ifdef CONFIG_WR_NODE
 
 #define TRACE_WRAP(...)
-#define TRACE_DEV(...) wrc_debug_printf(0, __VA_ARGS__)
+
+#ifdef CONFIG_TRACE_BIN
+/*
+ * Binary trace: store the format and the raw arguments in a ring,
+ * to be printed later by "trace" (or by tools/wrpc-trace). Arguments
+ * are saved as 32-bit words, so no 64-bit values, and "%s" strings
+ * are only printed if they are constant (see lib/trace.c).
+ */
+#define TRACE_BIN_ARGS	6	/* saved per record, the rest is lost */
+
+#define __TRACE_NARGS(...) __TRACE_NARGS_(__VA_ARGS__, \
+		15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define __TRACE_NARGS_(fmt, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, \
+		       a11, a12, a13, a14, a15, n, ...) n
+
+#define TRACE_DEV(...) trace_bin(__TRACE_NARGS(__VA_ARGS__), __VA_ARGS__)
+#define TRACE_LOG(sev, ...) TRACE_DEV(__VA_ARGS__) /* no severity */
+
+void trace_bin(int nargs, const char *fmt, ...);
+void trace_dump(int raw);
+void trace_clear(void);
+#else
+#define TRACE_DEV(...) wrc_debug_printf(TRACE_DEBUG, __VA_ARGS__)
+#define TRACE_LOG(sev, ...) wrc_debug_printf(sev, __VA_ARGS__)
+#endif
 
 #else /* WR_SWITCH */
 
 #define TRACE(...) pp_printf(__VA_ARGS__)
 #define TRACE_DEV(...) pp_printf(__VA_ARGS__)
+#define TRACE_LOG(sev, ...) pp_printf(__VA_ARGS__)
 
 #endif /* node/switch */
 
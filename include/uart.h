@@ -7,9 +7,15 @@ void uart_write_byte(int b);
 int uart_write_string(const char *s);
 int puts(const char *s);
 int uart_read_byte(void);
+int uart_rx_ready(void);
 
 /* uart-sw is used by ppsi (but may be wrapped to normal uart) */
 int uart_sw_write_string(const char *s);
+int uart_sw_rx_ready(void);
+
+/* Used by the console buffer: no newline conversion, -1 if busy */
+int uart_try_write_raw(int b);
+int uart_sw_try_write_raw(int b);
 
 
 #endif
@@ -22,4 +22,15 @@ void pcprintf(int row, int col, int color, const char *fmt, ...);
 /* Clears the terminal scree. */
 void term_clear();
 
+/*
+ * Fields for the monitor screen: scr_printf() only prints what
+ * changed since the previous refresh. scr_invalidate() forces a
+ * full redraw at the next scr_begin(); scr_end() erases the fields
+ * not printed and moves the cursor to "row".
+ */
+void scr_invalidate(void);
+void scr_begin(void);
+void scr_printf(int row, int col, int color, const char *fmt, ...);
+void scr_end(int row);
+
 #endif
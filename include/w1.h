@@ -23,6 +23,7 @@ static inline int w1_class(struct w1_dev *dev)
 struct w1_bus {
 	unsigned long detail; /* gpio bit or whatever (driver-specific) */
 	struct w1_dev devs[W1_MAX_DEVICES];
+	unsigned gen; /* bumped at each reset by w1.c: see w1_temp_poll() */
 };
 
 /*
@@ -73,6 +74,24 @@ extern int w1_read_eeprom(struct w1_dev *dev,
 extern int w1_write_eeprom(struct w1_dev *dev,
 			   int offset, const uint8_t *buffer, int blen);
 
+/*
+ * Background temperature readout: w1_temp_poll() is called from the main
+ * loop and does a few bit slots at a time, so it never blocks for the
+ * conversion. Readings are cached, with the time they were taken.
+ */
+#define W1_TEMP_NONE		(1 << 31)	/* no reading (yet) */
+
+struct w1_temp {
+	struct w1_dev *dev;
+	int32_t value;		/* 16.16 degrees, or W1_TEMP_NONE */
+	uint32_t tics;		/* timer_get_tics() of the reading */
+};
+
+extern void w1_temp_init(struct w1_bus *bus);
+extern void w1_temp_poll(void);
+extern int w1_temp_count(void);
+extern int32_t w1_temp_get(int index, uint32_t *tics);
+
 /* These are generic, using the first suitable device in the bus */
 extern int32_t w1_read_temp_bus(struct w1_bus *bus, unsigned long flags);
 extern int w1_read_eeprom_bus(struct w1_bus *bus,
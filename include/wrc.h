@@ -41,6 +41,9 @@ extern int abs(int val);
 extern void wr_servo_reset(void);
 void update_rx_queues(void);
 
+/* Bytes of stack never used since boot (see "mem") */
+int stack_unused(void);
+
 /* refresh period for _gui_ and _stat_ commands */
 extern int wrc_ui_refperiod;
 
@@ -49,6 +52,7 @@ int ad9516_init(void);
 void rts_init(void);
 int rtipc_init(void);
 void rts_update(void);
+void rts_loop_stats(uint32_t tics);
 void rtipc_action(void);
 
 #endif /* __WRC_H__ */
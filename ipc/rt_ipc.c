@@ -20,6 +20,16 @@
 #include <softpll_ng.h>
 
 static struct rts_pll_state pstate;
+static volatile struct rts_shmem *shmem = (void *)RTS_SHMEM_ADDR;
+
+/*
+ * The SoftPLL tells us what changed (spll_get_dirty), so rts_update()
+ * only reads those channels again; a minipc command or a change of
+ * reference makes it read them all.
+ */
+static uint32_t rts_dirty = SPLL_DIRTY_ALL;
+static uint32_t last_ipc_count, last_ref;
+static uint32_t rts_loops, rts_updates; /* for rts_loop_stats() */
 
 static void clear_state()
 {
@@ -99,46 +109,97 @@ int rts_lock_channel(int channel, int priority)
 void rts_init(void)
 {
     clear_state();
+    rts_dirty = SPLL_DIRTY_ALL;
+    shmem->seq = 0;
+    shmem->magic = RTS_SHMEM_MAGIC;
 }
 
-void rts_update(void)
+/* Copy the state to shared memory, see rts_shmem_read() */
+static void rts_publish(void)
 {
-    int i;
-    int n_ref;
-		int enabled;
-		
-    spll_get_num_channels(&n_ref, NULL);
+    shmem->seq++; /* odd: being written */
+    asm volatile("" ::: "memory");
+    memcpy((void *)&shmem->state, &pstate, sizeof(pstate));
+    asm volatile("" ::: "memory");
+    shmem->seq++;
+}
 
-    pstate.flags = (spll_check_lock(0) ? RTS_DMTD_LOCKED | RTS_REF_LOCKED : 0);
-    for(i=0;i<RTS_PLL_CHANNELS;i++)
-    {
-#define CH pstate.channels[i]
-        CH.flags = 0;
-        CH.phase_loopback = 0;
-        CH.phase_current = 0;
-//        CH.phase_setpoint = 0;
-        CH.phase_loopback = 0;
-
-        if(i >= n_ref)
-            CH.flags = CHAN_DISABLED;
-        else {
-            if(i==pstate.current_ref)
-            {
-                spll_get_phase_shift(0, &CH.phase_current, NULL);
-		            if(spll_shifter_busy(0))
-		            	CH.flags |= CHAN_SHIFTING;
-						}
-            if(spll_read_ptracker(i, &CH.phase_loopback, &enabled))
-	            CH.flags |= CHAN_PMEAS_READY;
-	          
-	          CH.flags |= (enabled ? CHAN_PTRACKER_ENABLED : 0);
+static void rts_update_channel(int i, int n_ref)
+{
+    int enabled;
 
+#define CH pstate.channels[i]
+    CH.flags = 0;
+    CH.phase_loopback = 0;
+    CH.phase_current = 0;
+
+    if(i >= n_ref)
+        CH.flags = CHAN_DISABLED;
+    else {
+        if(i==pstate.current_ref)
+        {
+            spll_get_phase_shift(0, &CH.phase_current, NULL);
+            if(spll_shifter_busy(0))
+                CH.flags |= CHAN_SHIFTING;
         }
+        if(spll_read_ptracker(i, &CH.phase_loopback, &enabled))
+            CH.flags |= CHAN_PMEAS_READY;
 
+        CH.flags |= (enabled ? CHAN_PTRACKER_ENABLED : 0);
+    }
 #undef CH
+    rts_updates++;
+}
+
+void rts_update(void)
+{
+    int i;
+    int n_ref;
+    uint32_t dirty;
+
+    rts_loops++;
+    dirty = rts_dirty | spll_get_dirty();
+    if(pstate.ipc_count != last_ipc_count || pstate.current_ref != last_ref)
+        dirty = SPLL_DIRTY_ALL;
+    if(!dirty)
+        return;
+    rts_dirty = 0;
+    last_ipc_count = pstate.ipc_count;
+    last_ref = pstate.current_ref;
+
+    spll_get_num_channels(&n_ref, NULL);
+
+    if(dirty & SPLL_DIRTY_LOCK) {
+        pstate.flags = (spll_check_lock(0) ? RTS_DMTD_LOCKED | RTS_REF_LOCKED : 0);
+        pstate.delock_count = spll_get_delock_count();
     }
+    /* The shifter only shows in the reference channel */
+    if((dirty & SPLL_DIRTY_SHIFT) && pstate.current_ref < RTS_PLL_CHANNELS)
+        dirty |= 1 << pstate.current_ref;
+
+    if(dirty == SPLL_DIRTY_ALL) {
+        for(i=0;i<RTS_PLL_CHANNELS;i++)
+            rts_update_channel(i, n_ref);
+    } else {
+        for(i=0;i<n_ref && i<RTS_PLL_CHANNELS;i++)
+            if(dirty & (1 << i))
+                rts_update_channel(i, n_ref);
+    }
+    rts_publish();
 }
 
+/* Called by the main loop every now and then, with the time since the last call */
+void rts_loop_stats(uint32_t tics)
+{
+    uint32_t ms = tics / (TICS_PER_SECOND / 1000); /* no 64-bit divide */
+
+    if(!ms)
+        return;
+    pstate.debug_data[0] = rts_loops * 1000 / ms;
+    pstate.debug_data[1] = rts_updates * 1000 / ms;
+    rts_loops = rts_updates = 0;
+    rts_dirty |= SPLL_DIRTY_LOCK; /* publish them */
+}
 
 /* fixme: this assumes the host is BE */
 static int htonl(int i)
@@ -94,9 +94,49 @@ struct rts_pll_state {
 
 	uint32_t ipc_count;
 	
+	/* [0]: main loop passes per second, [1]: channel updates per second */
 	uint32_t debug_data[8];
 };
 
+/*
+ * The RT CPU also publishes its state in shared memory, after the
+ * minipc buffers (mbox at 0x7000), so the host can read it at any rate
+ * without a round trip; minipc is only needed for commands. The
+ * writer makes "seq" odd while it copies the state; a reader retries
+ * if seq was odd or changed while it read. Fields are in the byte
+ * order of the RT CPU, like the minipc reply.
+ */
+#define RTS_SHMEM_ADDR	0x7c00
+#define RTS_SHMEM_MAGIC	0x52545331 /* "RTS1" */
+
+struct rts_shmem {
+	uint32_t magic;
+	uint32_t seq;
+	struct rts_pll_state state;
+};
+
+#ifndef __lm32__
+#include <string.h>
+
+/* Lock-free read of a consistent snapshot; -1 if never published */
+static inline int rts_shmem_read(const volatile struct rts_shmem *sh,
+				 struct rts_pll_state *state)
+{
+	uint32_t seq;
+
+	if (sh->magic != RTS_SHMEM_MAGIC)
+		return -1;
+	do {
+		while ((seq = sh->seq) & 1)
+			;
+		__sync_synchronize();
+		memcpy(state, (const void *)&sh->state, sizeof(*state));
+		__sync_synchronize();
+	} while (sh->seq != seq);
+	return 0;
+}
+#endif
+
 /* API */
 
 /* Connects to the RT CPU */
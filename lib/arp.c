@@ -10,6 +10,7 @@
 
 #include "endpoint.h"
 #include "ipv4.h"
+#include "task.h"
 #include "ptpd_netif.h"
 
 #ifndef htons
@@ -99,3 +100,10 @@ void arp_poll(void)
 		if ((len = process_arp(buf, len)) > 0)
 			ptpd_netif_sendto(arp_socket, &addr, buf, len, 0);
 }
+
+DEFINE_WRC_TASK(arp, 3) = {
+	.name = "arp",
+	.job = arp_poll,
+	.flags = TASK_LINK | TASK_EVENT,
+	.events = EV_RX,
+};
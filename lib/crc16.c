@@ -0,0 +1,20 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <crc16.h>
+
+/* Bitwise: we only checksum a few bytes at a time, so no table */
+uint16_t crc16(uint16_t crc, const void *buf, int len)
+{
+	const uint8_t *p = buf;
+	int i;
+
+	while (len--) {
+		crc ^= *p++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
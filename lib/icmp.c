@@ -30,7 +30,7 @@
 
 int process_icmp(uint8_t * buf, int len)
 {
-	int iplen, hisBodyLen;
+	int iplen;
 	uint8_t hisIP[4];
 	uint8_t myIP[4];
 	uint16_t sum;
@@ -46,44 +46,37 @@ int process_icmp(uint8_t * buf, int len)
 	if (buf[IP_PROTOCOL] != 0x01 || buf[ICMP_TYPE] != 0x08)
 		return 0;
 
-	hisBodyLen = iplen - 24;
-	if (hisBodyLen > 64)
-		hisBodyLen = 64;
+	/* Echo the whole payload, unless it was truncated on reception */
+	if (iplen < ICMP_END || iplen > len)
+		return 0;
 
 	memcpy(hisIP, buf + IP_SOURCE, 4);
 
 	// ------------ IP --------------
-	buf[IP_VERSION] = 0x45;
 	buf[IP_TOS] = 0;
-	buf[IP_LEN + 0] = (hisBodyLen + 24) >> 8;
-	buf[IP_LEN + 1] = (hisBodyLen + 24) & 0xff;
 	buf[IP_ID + 0] = 0;
 	buf[IP_ID + 1] = 0;
 	buf[IP_FLAGS + 0] = 0;
 	buf[IP_FLAGS + 1] = 0;
 	buf[IP_TTL] = 63;
-	buf[IP_PROTOCOL] = 1;	/* ICMP */
 	buf[IP_CHECKSUM + 0] = 0;
 	buf[IP_CHECKSUM + 1] = 0;
 	memcpy(buf + IP_SOURCE, myIP, 4);
 	memcpy(buf + IP_DEST, hisIP, 4);
 
+	sum = ipv4_checksum((unsigned short *)(buf + IP_VERSION), 10);
+	buf[IP_CHECKSUM + 0] = sum >> 8;
+	buf[IP_CHECKSUM + 1] = sum & 0xff;
+
 	// ------------ ICMP ---------
+	// Only the type changes, so patch the checksum instead of
+	// summing the payload again; the payload stays in place
+	sum = buf[ICMP_CHECKSUM + 0] << 8 | buf[ICMP_CHECKSUM + 1];
+	sum = ipv4_csum_update16(sum, buf[ICMP_TYPE] << 8 | buf[ICMP_CODE],
+				 0x00 << 8 | buf[ICMP_CODE]);
 	buf[ICMP_TYPE] = 0x0;	// echo reply
-	buf[ICMP_CODE] = 0;
-	buf[ICMP_CHECKSUM + 0] = 0;
-	buf[ICMP_CHECKSUM + 1] = 0;
-	// No need to copy payload; we modified things in-place
-
-	sum =
-	    ipv4_checksum((unsigned short *)(buf + ICMP_TYPE),
-			  (hisBodyLen + 4 + 1) / 2);
 	buf[ICMP_CHECKSUM + 0] = sum >> 8;
 	buf[ICMP_CHECKSUM + 1] = sum & 0xff;
 
-	sum = ipv4_checksum((unsigned short *)(buf + IP_VERSION), 10);
-	buf[IP_CHECKSUM + 0] = sum >> 8;
-	buf[IP_CHECKSUM + 1] = sum & 0xff;
-
-	return 24 + hisBodyLen;
+	return iplen;
 }
@@ -0,0 +1,116 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * The Internet checksum (RFC 1071), for ipv4.c and icmp.c. It has no
+ * other dependency, so tools/csum-bench.c builds it on the host too.
+ */
+#include <stdint.h>
+
+#include "ipv4.h"
+
+/*
+ * One's complement sum of "len" bytes, added to "sum" (not folded).
+ * We load 32 bits at a time and count the carries apart, so the
+ * inner loop has no fold. The lm32 can't do misaligned loads, so
+ * a leading byte and/or short are summed one by one; an odd start
+ * address sums the buffer byte-swapped, and we swap it back at the end.
+ */
+uint32_t ipv4_csum_partial(const void *buf, int len, uint32_t sum)
+{
+	const uint8_t *p = buf;
+	const uint32_t *w;
+	uint32_t acc = 0, carry = 0, v;
+	int odd = (unsigned long)p & 1;
+	union {
+		uint16_t s;
+		uint8_t b[2];
+	} u;
+
+	if (len <= 0)
+		return sum;
+
+	if (odd) {
+		u.b[0] = 0;
+		u.b[1] = *p++;
+		acc = u.s;
+		len--;
+	}
+	if (((unsigned long)p & 2) && len >= 2) {
+		acc += *(const uint16_t *)p;
+		p += 2;
+		len -= 2;
+	}
+
+	w = (const uint32_t *)p;
+	for (; len >= 16; len -= 16, w += 4) {
+		v = w[0]; acc += v; carry += (acc < v);
+		v = w[1]; acc += v; carry += (acc < v);
+		v = w[2]; acc += v; carry += (acc < v);
+		v = w[3]; acc += v; carry += (acc < v);
+	}
+	for (; len >= 4; len -= 4, w++) {
+		v = *w; acc += v; carry += (acc < v);
+	}
+	p = (const uint8_t *)w;
+
+	/* Fold into 17 bits, then add the tail short and byte */
+	acc = (acc >> 16) + (acc & 0xffff) + carry;
+	if (len >= 2) {
+		acc += *(const uint16_t *)p;
+		p += 2;
+		len -= 2;
+	}
+	if (len) {
+		u.b[0] = *p;
+		u.b[1] = 0;
+		acc += u.s;
+	}
+
+	acc = (acc >> 16) + (acc & 0xffff);
+	acc = (acc >> 16) + (acc & 0xffff);
+	if (odd)
+		acc = ((acc & 0xff) << 8) | (acc >> 8);
+
+	sum += acc;
+	return sum + (sum < acc);
+}
+
+/* Fold a partial sum to 16 bits and complement it */
+uint16_t ipv4_csum_fold(uint32_t sum)
+{
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += (sum >> 16);
+	return ~sum & 0xffff;
+}
+
+unsigned int ipv4_checksum(unsigned short *buf, int shorts)
+{
+	return ipv4_csum_fold(ipv4_csum_partial(buf, shorts * 2, 0));
+}
+
+/*
+ * Incremental update (RFC 1624, eqn. 3): HC' = ~(~HC + ~m + m').
+ * Both the checksum and the fields are in the same (wire) order
+ * as they are read from the frame.
+ */
+uint16_t ipv4_csum_update16(uint16_t csum, uint16_t old, uint16_t new)
+{
+	uint32_t sum;
+
+	sum = (uint16_t)~csum + (uint16_t)~old + new;
+	return ipv4_csum_fold(sum);
+}
+
+uint16_t ipv4_csum_update32(uint16_t csum, uint32_t old, uint32_t new)
+{
+	uint32_t sum;
+
+	sum = (uint16_t)~csum;
+	sum += (uint16_t)~(old >> 16) + (uint16_t)~(old & 0xffff);
+	sum += (new >> 16) + (new & 0xffff);
+	return ipv4_csum_fold(sum);
+}
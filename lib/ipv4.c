@@ -8,8 +8,10 @@
  */
 #include <string.h>
 
+#include "board.h"
 #include "endpoint.h"
 #include "ipv4.h"
+#include "task.h"
 #include "ptpd_netif.h"
 #include "hw/memlayout.h"
 #include "hw/etherbone-config.h"
@@ -22,21 +24,6 @@ int needIP = 1;
 static uint8_t myIP[4];
 static wr_socket_t *ipv4_socket;
 
-unsigned int ipv4_checksum(unsigned short *buf, int shorts)
-{
-	int i;
-	unsigned int sum;
-
-	sum = 0;
-	for (i = 0; i < shorts; ++i)
-		sum += buf[i];
-
-	sum = (sum >> 16) + (sum & 0xffff);
-	sum += (sum >> 16);
-
-	return (~sum & 0xffff);
-}
-
 void ipv4_init(const char *if_name)
 {
 	wr_sockaddr_t saddr;
@@ -55,34 +42,68 @@ void ipv4_init(const char *if_name)
 					       0, &saddr);
 }
 
+int ipv4_send(const uint8_t *mac, uint8_t *buf, int len)
+{
+	wr_sockaddr_t addr;
+
+	memcpy(addr.mac, mac, 6);
+	addr.ethertype = htons(0x0800);	/* IPv4 */
+	return ptpd_netif_sendto(ipv4_socket, &addr, buf, len, 0);
+}
+
 static int bootp_retry = 0;
-static int bootp_timer = 0;
+
+/* Static: the largest frame we may get does not fit the stack */
+static uint8_t ipv4_buf[NET_SKBUF_SIZE - 32];
 
 void ipv4_poll(void)
 {
-	uint8_t buf[400];
 	wr_sockaddr_t addr;
 	int len;
 
-	if ((len = ptpd_netif_recvfrom(ipv4_socket, &addr,
-				       buf, sizeof(buf), 0)) > 0) {
+	if ((len = ptpd_netif_recvfrom(ipv4_socket, &addr, ipv4_buf,
+				       sizeof(ipv4_buf), 0)) > 0) {
 		if (needIP)
-			process_bootp(buf, len);
+			process_bootp(ipv4_buf, len);
 
-		if (!needIP && (len = process_icmp(buf, len)) > 0)
-			ptpd_netif_sendto(ipv4_socket, &addr, buf, len, 0);
+		if (!needIP && (len = process_icmp(ipv4_buf, len)) > 0)
+			ptpd_netif_sendto(ipv4_socket, &addr, ipv4_buf, len, 0);
 	}
+}
 
-	if (needIP && bootp_timer == 0) {
-		len = send_bootp(buf, ++bootp_retry);
+DEFINE_WRC_TASK(ipv4, 3) = {
+	.name = "ipv4",
+	.job = ipv4_poll,
+	.flags = TASK_LINK | TASK_EVENT,
+	.events = EV_RX,
+};
 
-		memset(addr.mac, 0xFF, 6);
-		addr.ethertype = htons(0x0800);	/* IPv4 */
-		ptpd_netif_sendto(ipv4_socket, &addr, buf, len, 0);
-	}
+/* Send a request when woken at link up, then every BOOTP_PERIOD */
+static void bootp_poll(void)
+{
+	wr_sockaddr_t addr;
+	int len;
+
+	if (!needIP)
+		return;
+	len = send_bootp(ipv4_buf, ++bootp_retry);
 
-	if (needIP && ++bootp_timer == 100000)
-		bootp_timer = 0;
+	memset(addr.mac, 0xFF, 6);
+	addr.ethertype = htons(0x0800);	/* IPv4 */
+	ptpd_netif_sendto(ipv4_socket, &addr, ipv4_buf, len, 0);
+}
+
+DEFINE_WRC_TASK(bootp, 3) = {
+	.name = "bootp",
+	.job = bootp_poll,
+	.period = BOOTP_PERIOD,
+	.flags = TASK_LINK | TASK_EVENT,
+};
+
+void ipv4_link_up(void)
+{
+	needIP = 1;
+	task_wake(WRC_TASK(bootp));
 }
 
 void getIP(unsigned char *IP)
@@ -103,8 +124,6 @@ void setIP(unsigned char *IP)
 		*eb_ip = ip;
 
 	needIP = (ip == 0);
-	if (!needIP) {
+	if (!needIP)
 		bootp_retry = 0;
-		bootp_timer = 0;
-	}
 }
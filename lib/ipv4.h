@@ -5,9 +5,21 @@
 
 void ipv4_init(const char *if_name);
 void ipv4_poll(void);
+void ipv4_link_up(void);
+int ipv4_send(const uint8_t *mac, uint8_t *buf, int len);
+
+/* Outgoing UDP: the payload starts at buf + UDP_HDR_LEN */
+#define UDP_HDR_LEN 28
+int udp_build(uint8_t *buf, int len, const uint8_t *dst_ip,
+	      int sport, int dport);
 
 /* Internal to IP stack: */
 unsigned int ipv4_checksum(unsigned short *buf, int shorts);
+uint32_t ipv4_csum_partial(const void *buf, int len, uint32_t sum);
+uint16_t ipv4_csum_fold(uint32_t sum);
+/* Fix a checksum after rewriting a 16-bit or 32-bit field in place */
+uint16_t ipv4_csum_update16(uint16_t csum, uint16_t old, uint16_t new);
+uint16_t ipv4_csum_update32(uint16_t csum, uint32_t old, uint32_t new);
 
 void arp_init(const char *if_name);
 void arp_poll(void);
@@ -19,5 +31,6 @@ void getIP(unsigned char *IP);
 int process_icmp(uint8_t * buf, int len);
 int process_bootp(uint8_t * buf, int len);	/* non-zero if IP was set */
 int send_bootp(uint8_t * buf, int retry);
+#define BOOTP_PERIOD 1000	/* ms between requests */
 
 #endif
@@ -1,5 +1,12 @@
 obj-y += lib/util.o lib/atoi.o
-obj-y += lib/usleep.o
-obj-$(CONFIG_WR_NODE) += lib/net.o
+obj-y += lib/usleep.o lib/crc16.o
+obj-$(CONFIG_WR_NODE) += lib/net.o lib/task.o
 
 obj-$(CONFIG_ETHERBONE) += lib/arp.o lib/icmp.o lib/ipv4.o lib/bootp.o
+obj-$(CONFIG_ETHERBONE) += lib/ipv4-csum.o
+obj-$(CONFIG_ETHERBONE) += lib/udp.o
+obj-$(CONFIG_TELEMETRY) += lib/telemetry.o
+obj-$(CONFIG_TEMPCOMP) += lib/tempcomp.o
+obj-$(CONFIG_SYSLOG) += lib/syslog.o
+obj-$(CONFIG_TRACE_BIN) += lib/trace.o
+obj-$(CONFIG_STAT_BIN) += lib/stat-bin.o
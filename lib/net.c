@@ -10,6 +10,7 @@
 #include "minic.h"
 #include "endpoint.h"
 #include "softpll_ng.h"
+#include "task.h"
 
 #define min(x,y) ((x) < (y) ? (x) : (y))
 
@@ -363,3 +364,11 @@ void update_rx_queues()
 	TRACE_WRAP("%s: saved packet to queue [avail %d n %d size %d]\n",
 		   __FUNCTION__, q->avail, q->n, q_required);
 }
+
+DEFINE_WRC_TASK(rx, 0) = {
+	.name = "rx",
+	.job = update_rx_queues,
+	.budget = 2,
+	.flags = TASK_LINK | TASK_EVENT,
+	.events = EV_RX,
+};
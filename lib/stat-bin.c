@@ -0,0 +1,123 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * "stat bin" records: we fill the fields (for both monitors), add the
+ * sequence number and crc and print the record as one base64 line.
+ * This is much shorter than the text line, and needs no 64-bit
+ * divisions or printf, so it can be used at high refresh rates, up to
+ * what the UART carries: a shorter period is stretched.
+ */
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <wrc.h>
+#include <w1.h>
+
+#ifdef CONFIG_PPSI
+#include <ppsi/ppsi.h>
+#include <wr-api.h>
+#else
+#include "ptpd_exports.h"
+#endif
+
+#include "board.h"
+#include "hal_exports.h"
+#include "softpll_ng.h"
+#include "minic.h"
+#include "pps_gen.h"
+#include "syscon.h"
+#include "crc16.h"
+#include "stat-bin.h"
+
+extern ptpdexp_sync_state_t cur_servo_state;
+
+/* A line (start, base64, newline) at 10 bits per character */
+#define STAT_BIN_MIN_TICS ((int)((STAT_BIN_LEN + 2) * 10ULL	\
+				 * TICS_PER_SECOND / UART_BAUDRATE + 1))
+
+int wrc_stat_bin;
+
+static const char b64[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static uint32_t stat_bin_seq;
+
+void stat_bin_send(struct stat_rec *r)
+{
+	static char line[1 + STAT_BIN_LEN + 2];
+	uint8_t *p = (void *)r;
+	char *s = line;
+	uint32_t v;
+	int i, n = sizeof(*r);
+
+	r->magic = STAT_BIN_MAGIC;
+	r->version = STAT_BIN_VERSION;
+	r->seq = stat_bin_seq++;
+	r->crc = crc16(0xffff, r, offsetof(struct stat_rec, crc));
+
+	*s++ = STAT_BIN_START;
+	for (i = 0; i < n; i += 3) {
+		v = p[i] << 16;
+		if (i + 1 < n)
+			v |= p[i + 1] << 8;
+		if (i + 2 < n)
+			v |= p[i + 2];
+		*s++ = b64[v >> 18];
+		*s++ = b64[(v >> 12) & 0x3f];
+		*s++ = i + 1 < n ? b64[(v >> 6) & 0x3f] : '=';
+		*s++ = i + 2 < n ? b64[v & 0x3f] : '=';
+	}
+	*s++ = '\n';
+	*s = '\0';
+	puts(line);
+}
+
+/* The same values as the text line of the monitor, see stat-bin.h */
+void wrc_log_stats_bin(void)
+{
+	static uint32_t last;
+	struct stat_rec r;
+	hexp_port_state_t ps;
+	int tx, rx;
+	uint64_t sec;
+	uint32_t nsec;
+
+	/* Don't queue lines faster than the UART sends them */
+	if (time_before(timer_get_tics(), last + STAT_BIN_MIN_TICS))
+		return;
+	last = timer_get_tics();
+
+	memset(&r, 0, sizeof(r));
+	shw_pps_gen_get_time(&sec, &nsec);
+	halexp_get_port_state(&ps, NULL);
+	minic_get_stats(&tx, &rx);
+	r.flags = (ps.up ? STAT_F_LINK_UP : 0)
+		| (ps.is_locked ? STAT_F_PLL_LOCKED : 0)
+		| (cur_servo_state.valid ? STAT_F_SERVO_VALID : 0);
+	r.rx = rx;
+	r.tx = tx;
+	r.aux = spll_get_aux_status(0);
+	r.sec = sec;
+	r.nsec = nsec;
+	r.mu = cur_servo_state.mu;
+	r.delay_ms = cur_servo_state.delay_ms;
+	r.delta_tx_m = cur_servo_state.delta_tx_m;
+	r.delta_rx_m = cur_servo_state.delta_rx_m;
+	r.delta_tx_s = cur_servo_state.delta_tx_s;
+	r.delta_rx_s = cur_servo_state.delta_rx_s;
+	r.asymmetry = cur_servo_state.total_asymmetry;
+	r.cur_offset = cur_servo_state.cur_offset;
+	r.cur_setpoint = cur_servo_state.cur_setpoint;
+	r.dac_hpll = spll_get_dac(-1);
+	r.dac_main = spll_get_dac(0);
+	r.dac_aux = spll_get_dac(1);
+	r.update_count = cur_servo_state.update_count;
+	r.temp = w1_temp_get(0, NULL);
+	strncpy(r.servo_state, cur_servo_state.slave_servo_state,
+		sizeof(r.servo_state));
+	stat_bin_send(&r);
+}
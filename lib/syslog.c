@@ -0,0 +1,134 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * A syslog sink (RFC 5424 over UDP, RFC 5426) for trace messages.
+ * Text is accumulated in a batch, and one datagram is sent when the
+ * batch is full, when the severity changes or when the oldest text
+ * has waited SYSLOG_FLUSH_MS. So a burst of trace lines costs a few
+ * frames instead of many UART bytes. A rate limiter caps the
+ * datagrams per second; what it drops, and what comes before we
+ * have an IP address, is counted and reported in the next datagram
+ * that goes out.
+ */
+#include <string.h>
+#include <wrc.h>
+#include <task.h>
+
+#include "ipv4.h"
+#include "syslog.h"
+
+#define SYSLOG_BATCH	256	/* bytes of text per datagram */
+#define SYSLOG_HDR	128	/* worst case for header and "dropped" line */
+#define SYSLOG_FLUSH_MS	100
+
+struct syslog_cfg syslog_cfg = {
+	.mac = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+	.port = SYSLOG_PORT,
+	.rate = 10,
+};
+
+static uint8_t frame[UDP_HDR_LEN + SYSLOG_HDR + SYSLOG_BATCH];
+static char batch[SYSLOG_BATCH];
+static int batch_len, batch_lines, batch_sev;
+static uint32_t batch_tics;
+
+static uint32_t rate_tics;
+static int rate_count, dropped_report;
+static uint32_t seq;
+
+static void syslog_flush(void)
+{
+	char *p = (char *)frame + UDP_HDR_LEN;
+	uint8_t ip[4];
+	uint32_t now = timer_get_tics();
+	int len;
+
+	if (!batch_len)
+		return;
+
+	/* Rate limiter: count datagrams within the current second */
+	if (time_after_eq(now, rate_tics + TICS_PER_SECOND)) {
+		rate_tics = now;
+		rate_count = 0;
+	}
+	if (syslog_cfg.rate && rate_count >= syslog_cfg.rate) {
+		syslog_cfg.dropped += batch_lines;
+		batch_len = batch_lines = 0;
+		return;
+	}
+	rate_count++;
+
+	/*
+	 * "<PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID [SD] MSG".
+	 * We have no calendar time before PTP is there, so the timestamp
+	 * is NILVALUE and the "meta" element carries the uptime (in
+	 * hundredths of a second, as RFC 5424 says) and a sequence number.
+	 */
+	getIP(ip);
+	len = sprintf(p, "<%d>1 - %d.%d.%d.%d wrpc - - "
+		      "[meta sequenceId=\"%d\" sysUpTime=\"%d\"] ",
+		      16 * 8 + batch_sev, ip[0], ip[1], ip[2], ip[3],
+		      ++seq, now / (TICS_PER_SECOND / 100));
+	if (syslog_cfg.dropped != dropped_report) {
+		len += sprintf(p + len, "(%d lines dropped)\n",
+			       syslog_cfg.dropped - dropped_report);
+		dropped_report = syslog_cfg.dropped;
+	}
+	memcpy(p + len, batch, batch_len);
+	len += batch_len;
+	batch_len = batch_lines = 0;
+
+	len = udp_build(frame, len, syslog_cfg.ip, syslog_cfg.port,
+			syslog_cfg.port);
+	ipv4_send(syslog_cfg.mac, frame, len);
+}
+
+int syslog_vprintf(int severity, const char *fmt, va_list args)
+{
+	static char line[CONFIG_PRINT_BUFSIZE];
+	int len;
+
+	if (!syslog_cfg.enabled)
+		return 0;
+	if (needIP) {
+		/* No source address yet: reported with the first datagram */
+		syslog_cfg.dropped++;
+		return 0;
+	}
+
+	len = pp_vsprintf(line, fmt, args);
+	if (len > SYSLOG_BATCH)
+		len = SYSLOG_BATCH;
+
+	if (batch_len && (severity != batch_sev
+			  || batch_len + len > SYSLOG_BATCH))
+		syslog_flush();
+
+	if (!batch_len) {
+		batch_sev = severity;
+		batch_tics = timer_get_tics();
+	}
+	memcpy(batch + batch_len, line, len);
+	batch_len += len;
+	batch_lines++;
+	return len;
+}
+
+void syslog_poll(void)
+{
+	if (batch_len && time_after_eq(timer_get_tics(),
+				       batch_tics + SYSLOG_FLUSH_MS
+				       * TICS_PER_SECOND / 1000))
+		syslog_flush();
+}
+
+DEFINE_WRC_TASK(syslog, 5) = {
+	.name = "syslog",
+	.job = syslog_poll,
+	.period = 10,
+	.flags = TASK_LINK,
+};
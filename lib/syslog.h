@@ -0,0 +1,30 @@
+#ifndef __WRC_SYSLOG_H__
+#define __WRC_SYSLOG_H__
+
+#include <stdarg.h>
+#include <inttypes.h>
+
+/* Severities, as in RFC 5424; we always use facility local0 */
+#define SYSLOG_ERR	3
+#define SYSLOG_WARNING	4
+#define SYSLOG_NOTICE	5
+#define SYSLOG_INFO	6
+#define SYSLOG_DEBUG	7
+
+#define SYSLOG_PORT	514
+
+struct syslog_cfg {
+	int enabled;
+	uint8_t ip[4];
+	uint8_t mac[6];
+	int port;
+	int rate;		/* max datagrams per second, 0 = no limit */
+	int dropped;		/* lines lost to the rate limiter or no IP */
+};
+extern struct syslog_cfg syslog_cfg;
+
+/* Queue text for the collector; returns 0 if syslog is not active */
+int syslog_vprintf(int severity, const char *fmt, va_list args);
+void syslog_poll(void);
+
+#endif /* __WRC_SYSLOG_H__ */
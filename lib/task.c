@@ -0,0 +1,140 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <wrc.h>
+#include <task.h>
+
+#include "irq.h"
+#include "minic.h"
+#include "uart.h"
+
+int wrc_link_up;
+
+/* Written by the softpll interrupt too, while task_waiting is set */
+static volatile uint32_t task_events;
+static volatile uint32_t task_tics;
+volatile int task_waiting;
+
+struct task_idle_stats task_idle_stats;
+static uint32_t win_start, win_idle; /* the current one-second window */
+
+/*
+ * Called with interrupts off: there's no interrupt for the minic, the
+ * uart or the timer in the gateware, so while we wait in idle the
+ * softpll interrupt (a few thousand per second) looks at them for us.
+ */
+void task_sample_events(void)
+{
+	uint32_t ev = 0;
+
+	if (minic_poll_rx())
+		ev |= EV_RX;
+	if (uart_rx_ready())
+		ev |= EV_UART;
+	task_events |= ev;
+	task_tics = timer_get_tics();
+}
+
+static void task_sample_now(void)
+{
+	unsigned int ie = irq_save();
+
+	task_sample_events();
+	irq_restore(ie);
+}
+
+/* Wait until an event or the deadline, with no access to the bus */
+static void task_idle(uint32_t deadline)
+{
+	struct task_idle_stats *s = &task_idle_stats;
+	uint32_t start = task_tics;
+	int i;
+
+	task_waiting = 1;
+	for (i = 0; i < TASK_IDLE_SPINS; i++)
+		if (task_events || !time_before(task_tics, deadline))
+			break;
+	task_waiting = 0;
+	task_sample_now();
+
+	s->idle += task_tics - start;
+	win_idle += task_tics - start;
+	if (task_tics - win_start >= TICS_PER_SECOND) {
+		s->last_pct = win_idle * 100 / (task_tics - win_start);
+		win_start = task_tics;
+		win_idle = 0;
+	}
+}
+
+static int task_due(struct wrc_task *t, uint32_t now, uint32_t ev)
+{
+	if (t->pending || (t->events & ev))
+		return 1;
+	if (t->period)
+		return time_after_eq(now, t->next);
+	return !(t->flags & TASK_EVENT);
+}
+
+/* One pass of the main loop: run all the jobs that are due, then wait */
+void task_run(void)
+{
+	struct wrc_task *t;
+	uint32_t now, dt, ev, deadline;
+	unsigned int ie;
+	int budget;
+
+	ie = irq_save();
+	task_sample_events();
+	ev = task_events;
+	task_events = 0;
+	irq_restore(ie);
+	deadline = task_tics + TASK_IDLE_MAX * TICS_PER_SECOND / 1000;
+
+	for (t = __task_begin; t < __task_end; t++) {
+		if ((t->flags & TASK_LINK) && !wrc_link_up)
+			continue;
+		now = timer_get_tics();
+		if (task_due(t, now, ev)) {
+			t->pending = 0;
+			if (t->period) {
+				t->next += t->period * TICS_PER_SECOND / 1000;
+				/* Don't try to catch up after a long job */
+				if (time_before(t->next, now))
+					t->next = now
+						+ t->period * TICS_PER_SECOND / 1000;
+			}
+
+			t->job();
+
+			dt = timer_get_tics() - now;
+			budget = t->budget ? t->budget : TASK_BUDGET;
+			t->nrun++;
+			t->total_tics += dt;
+			if (dt > t->max_tics)
+				t->max_tics = dt;
+			if (dt > budget * TICS_PER_SECOND / 1000)
+				t->noverrun++;
+		}
+		/* When must we be back? */
+		if (t->pending || (!t->period && !(t->flags & TASK_EVENT)))
+			deadline = now;
+		else if (t->period && time_before(t->next, deadline))
+			deadline = t->next;
+	}
+	task_sample_now();
+	if (!task_events && time_before(task_tics, deadline))
+		task_idle(deadline);
+}
+
+void task_clear_stats(void)
+{
+	struct wrc_task *t;
+
+	for (t = __task_begin; t < __task_end; t++)
+		t->nrun = t->noverrun = t->max_tics = t->total_tics = 0;
+	task_sample_now();
+	task_idle_stats.start = win_start = task_tics;
+	task_idle_stats.idle = win_idle = 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <string.h>
+#include <wrc.h>
+#include <task.h>
+#include <w1.h>
+
+#ifdef CONFIG_PPSI
+#include <ppsi/ppsi.h>
+#include <wr-api.h>
+#else
+#include "ptpd_exports.h"
+#endif
+
+#include "softpll_ng.h"
+#include "pps_gen.h"
+#include "telemetry.h"
+#include "ipv4.h"
+
+extern ptpdexp_sync_state_t cur_servo_state;
+
+struct telemetry_cfg telemetry_cfg = {
+	.mac = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+	.port = TELEMETRY_PORT,
+	.period = TICS_PER_SECOND,
+};
+
+void telemetry_poll(void)
+{
+	static uint8_t buf[UDP_HDR_LEN + sizeof(struct telemetry_rec)];
+	static uint32_t last, last_ucnt, seq;
+	struct telemetry_rec *r = (void *)(buf + UDP_HDR_LEN);
+	uint64_t sec;
+	uint32_t nsec;
+	int32_t phase;
+	int enabled, len;
+
+	if (!telemetry_cfg.enabled || needIP)
+		return;
+
+	if (telemetry_cfg.period) {
+		if (time_before(timer_get_tics(), last + telemetry_cfg.period))
+			return;
+	} else if (cur_servo_state.update_count == last_ucnt) {
+		return;
+	}
+	last = timer_get_tics();
+	last_ucnt = cur_servo_state.update_count;
+
+	r->magic = TELEMETRY_MAGIC;
+	r->version = TELEMETRY_VERSION;
+	r->flags = 0;
+	r->seq = seq++;
+	shw_pps_gen_get_time(&sec, &nsec);
+	r->sec = (uint32_t)sec;
+	r->nsec = nsec;
+
+	if (cur_servo_state.valid)
+		r->flags |= TELEMETRY_F_SERVO_VALID;
+	r->mu = cur_servo_state.mu;
+	r->delay_ms = cur_servo_state.delay_ms;
+	r->cur_offset = cur_servo_state.cur_offset;
+	r->cur_setpoint = cur_servo_state.cur_setpoint;
+	r->cur_skew = cur_servo_state.cur_skew;
+	r->update_count = cur_servo_state.update_count;
+
+	if (spll_check_lock(0))
+		r->flags |= TELEMETRY_F_PLL_LOCKED;
+	r->dac_hpll = spll_get_dac(-1);
+	r->dac_main = spll_get_dac(0);
+	r->dac_aux = spll_get_dac(1);
+	r->ptrack_phase = 0;
+	enabled = 0;
+	if (spll_read_ptracker(0, &phase, &enabled))
+		r->ptrack_phase = phase;
+	if (enabled)
+		r->flags |= TELEMETRY_F_PTRACK_EN;
+	r->temp = w1_temp_get(0, NULL);
+
+	len = udp_build(buf, sizeof(*r), telemetry_cfg.ip,
+			telemetry_cfg.port, telemetry_cfg.port);
+	ipv4_send(telemetry_cfg.mac, buf, len);
+}
+
+DEFINE_WRC_TASK(telemetry, 5) = {
+	.name = "telemetry",
+	.job = telemetry_poll,
+	.period = 10,
+	.flags = TASK_LINK,
+};
@@ -0,0 +1,204 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * Temperature compensation of the fixed delays. Every TC_PERIOD we take
+ * a sample of temperature and round-trip delay (mu) while the servo is
+ * tracking, and update an exponentially-weighted least-squares fit of
+ * mu against temperature: means and (co)variances are running sums, so
+ * there is no history and a sample costs two multiplies, plus one
+ * 32-bit divide for the slope. The slope
+ * times the distance from the reference temperature is taken as the
+ * drift of our fixed delays, half on tx and half on rx; the servo gets
+ * it from ep_get_deltas() when it reads its calibration data.
+ *
+ * Temperatures are in 1/256 degrees, delays in ps.
+ */
+#include <string.h>
+#include <wrc.h>
+#include <task.h>
+#include <w1.h>
+
+#ifdef CONFIG_PPSI
+#include <ppsi/ppsi.h>
+#include <wr-api.h>
+#else
+#include "ptpd_exports.h"
+#endif
+
+#include "softpll_ng.h"
+#include "eeprom.h"
+#include "tempcomp.h"
+
+extern ptpdexp_sync_state_t cur_servo_state;
+
+#define TC_PERIOD	(4 * TICS_PER_SECOND)
+#define TC_SHIFT	12		/* memory: 2^12 samples, 4.5 hours */
+#define TC_WARMUP	256		/* samples before we trust the fit */
+#define TC_MIN_VAR	(128 * 128)	/* half a degree, squared */
+#define TC_MAX_PS	2000
+
+struct tempcomp tempcomp = {
+	.enabled = 1,
+	.ref = TEMPCOMP_NO_REF,
+};
+
+static struct {
+	int n;
+	int linked;		/* mu0 is valid for this servo run */
+	int32_t mu0;		/* the fit is on mu - mu0 */
+	int32_t mx, my;		/* means, << TC_SHIFT */
+	int64_t cxx, cxy;	/* variance and covariance, << TC_SHIFT */
+	int32_t slope;		/* cxy / cxx, Q16: ps per 1/256 degree */
+	int32_t corr;		/* round-trip correction */
+	uint32_t last;
+	/* the last sample, for "tempcomp" */
+	int32_t temp, mu, t24p, ptrack, dac;
+} tc;
+
+void tempcomp_reset(void)
+{
+	memset(&tc, 0, sizeof(tc));
+	tempcomp.dtx = tempcomp.drx = 0;
+}
+
+static int tc_fit_valid(void)
+{
+	return tc.n >= TC_WARMUP
+		&& tc.cxx >= ((int64_t)TC_MIN_VAR << TC_SHIFT);
+}
+
+static void tc_sample(int32_t x, int32_t y)
+{
+	int32_t dx, dy;
+
+	if (!tc.n) {
+		tc.mx = x << TC_SHIFT;
+		tc.my = y << TC_SHIFT;
+	}
+	tc.n++;
+	dx = x - (tc.mx >> TC_SHIFT);
+	dy = y - (tc.my >> TC_SHIFT);
+	tc.mx += dx;
+	tc.my += dy;
+	tc.cxx += (int64_t)dx * dx - (tc.cxx >> TC_SHIFT);
+	tc.cxy += (int64_t)dx * dy - (tc.cxy >> TC_SHIFT);
+}
+
+/*
+ * cxy / cxx in Q16, with 32-bit divides only (no __divdi3): bring cxx
+ * down to 15 bits, cxy by the same shift, then divide in two steps so
+ * that the remainder << 16 still fits. Only called when tc_fit_valid().
+ */
+static void tc_update_slope(void)
+{
+	int64_t n = tc.cxy;
+	int32_t d, q, r;
+	int k = 0;
+
+	while ((tc.cxx >> k) >= (1 << 15))
+		k++;
+	d = tc.cxx >> k;
+	n >>= k;
+	/* d is at least 2^14 here, so q << 16 fits if |n| < 2^29 */
+	if (n >= (1 << 29) || n <= -(1 << 29)) {
+		tc.slope = n < 0 ? -0x7fffffff : 0x7fffffff; /* corr is clamped */
+		return;
+	}
+	q = (int32_t)n / d;
+	r = (int32_t)n - q * d;
+	tc.slope = (q << 16) + (r << 16) / d;
+}
+
+void tempcomp_poll(void)
+{
+	int32_t temp, c;
+
+	if (time_before(timer_get_tics(), tc.last + TC_PERIOD))
+		return;
+	tc.last = timer_get_tics();
+
+	temp = w1_temp_get(0, NULL);
+	if (temp == W1_TEMP_NONE)
+		return;
+	temp >>= 8;
+
+	if (!cur_servo_state.valid) {
+		tc.linked = 0;
+		return;
+	}
+	/* A new link may have a different mu: carry on from the mean */
+	if (!tc.linked)
+		tc.mu0 = cur_servo_state.mu - (tc.my >> TC_SHIFT);
+	tc.linked = 1;
+	if (tempcomp.ref == TEMPCOMP_NO_REF)
+		tempcomp.ref = temp;
+
+	tc.temp = temp;
+	tc.mu = cur_servo_state.mu;
+	tc.t24p = cal_phase_transition;
+	spll_read_ptracker(0, &tc.ptrack, NULL);
+	tc.dac = spll_get_dac(0);
+	tc_sample(temp, tc.mu - tc.mu0);
+
+	if (!tc_fit_valid())
+		return;
+	tc_update_slope();
+	c = ((int64_t)tc.slope * (temp - tempcomp.ref)) >> 16;
+	if (c > TC_MAX_PS)
+		c = TC_MAX_PS;
+	if (c < -TC_MAX_PS)
+		c = -TC_MAX_PS;
+	tc.corr = c;
+	if (tempcomp.enabled) {
+		tempcomp.dtx = c / 2;
+		tempcomp.drx = c - c / 2;
+	} else {
+		tempcomp.dtx = tempcomp.drx = 0;
+	}
+}
+
+DEFINE_WRC_TASK(tempcomp, 5) = {
+	.name = "tempcomp",
+	.job = tempcomp_poll,
+	.period = 10,
+	.flags = TASK_LINK,
+};
+
+/* Print a value in 1/256 units with two decimals */
+static void tc_print_fixed(int32_t v)
+{
+	if (v < 0) {
+		mprintf("-");
+		v = -v;
+	}
+	mprintf("%d.%02d", v >> 8, ((v & 0xff) * 100) >> 8);
+}
+
+void tempcomp_show(void)
+{
+	mprintf("tempcomp: %s, ref ", tempcomp.enabled ? "on" : "off");
+	if (tempcomp.ref == TEMPCOMP_NO_REF)
+		mprintf("--");
+	else
+		tc_print_fixed(tempcomp.ref);
+	mprintf(" C, %d samples\n", tc.n);
+
+	if (tc_fit_valid()) {
+		mprintf("fit: ");
+		tc_print_fixed(tc.slope); /* ps per degree, 1/256 units */
+		mprintf(" ps/C round trip, correction %d ps (tx %d, rx %d)\n",
+			tc.corr, tempcomp.dtx, tempcomp.drx);
+	} else {
+		mprintf("fit: not enough samples or temperature range\n");
+	}
+	if (!tc.n)
+		return;
+	mprintf("last: temp ");
+	tc_print_fixed(tc.temp);
+	mprintf(" C, mu %d ps, t24p %d ps, ptrack %d ps, dac %d\n",
+		tc.mu, tc.t24p, tc.ptrack, tc.dac);
+}
@@ -0,0 +1,141 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * Binary trace ring. TRACE_DEV() only saves the time, the format
+ * pointer and the raw arguments, with interrupts off for the few
+ * stores; the expensive part, printf, is done when the ring is dumped.
+ * The format is used again at that time, so it must be a constant
+ * (as it always is), and so must be any "%s" argument: the ones that
+ * point outside of the program image (e.g. a buffer filled by
+ * format_time()) are printed as "(?)" because they may have changed.
+ */
+#include <stdarg.h>
+#include <string.h>
+#include <wrc.h>
+
+#include "syscon.h"
+#include "irq.h"
+
+struct trace_rec {
+	const char *fmt;
+	uint32_t tics;
+	uint32_t nargs;
+	uint32_t args[TRACE_BIN_ARGS];
+};
+
+static struct {
+	int next;		/* where the next record goes */
+	uint32_t count;		/* records written since clear */
+	struct trace_rec rec[CONFIG_TRACE_BIN_ENTRIES];
+} trace;
+
+#if TRACE_BIN_ARGS != 6
+#error "trace_dump() passes six arguments to printf"
+#endif
+
+extern char _fbss[]; /* end of text, rodata and data */
+
+void trace_bin(int nargs, const char *fmt, ...)
+{
+	struct trace_rec *r;
+	va_list ap;
+	uint32_t ie;
+	int i;
+
+	/* The softpll interrupt may trace too */
+	ie = irq_save();
+	r = trace.rec + trace.next;
+	if (++trace.next == CONFIG_TRACE_BIN_ENTRIES)
+		trace.next = 0;
+	trace.count++;
+	r->fmt = fmt;
+	r->tics = timer_get_tics();
+	r->nargs = nargs;
+	va_start(ap, fmt);
+	for (i = 0; i < nargs && i < TRACE_BIN_ARGS; i++)
+		r->args[i] = va_arg(ap, uint32_t);
+	va_end(ap);
+	irq_restore(ie);
+}
+
+/* Replace the "%s" arguments we can't trust */
+static void trace_fix_strings(struct trace_rec *r)
+{
+	const char *f = r->fmt;
+	int i = 0;
+
+	while (*f && i < TRACE_BIN_ARGS) {
+		if (*f++ != '%')
+			continue;
+		if (*f == '%') {
+			f++;
+			continue;
+		}
+		while (*f && strchr("-+ #0123456789.lhz", *f))
+			f++;
+		if (*f == 's' && (r->args[i] == 0
+				  || r->args[i] >= (uint32_t)_fbss))
+			r->args[i] = (uint32_t)"(?)";
+		if (*f)
+			f++;
+		i++;
+	}
+}
+
+void trace_dump(int raw)
+{
+	struct trace_rec r;
+	uint32_t ie, count;
+	int i, n, pos;
+
+	ie = irq_save();
+	count = trace.count;
+	n = count < CONFIG_TRACE_BIN_ENTRIES ? count : CONFIG_TRACE_BIN_ENTRIES;
+	pos = trace.next - n;
+	irq_restore(ie);
+	if (pos < 0)
+		pos += CONFIG_TRACE_BIN_ENTRIES;
+
+	for (i = 0; i < n; i++) {
+		/* Records may be overwritten while we print them */
+		ie = irq_save();
+		r = trace.rec[pos];
+		irq_restore(ie);
+		if (++pos == CONFIG_TRACE_BIN_ENTRIES)
+			pos = 0;
+		if (r.nargs < TRACE_BIN_ARGS)
+			memset(r.args + r.nargs, 0,
+			       (TRACE_BIN_ARGS - r.nargs) * sizeof(r.args[0]));
+		if (raw) {
+			pp_printf("%x %x %d %x %x %x %x %x %x\n", r.tics,
+				  (uint32_t)r.fmt, r.nargs, r.args[0], r.args[1],
+				  r.args[2], r.args[3], r.args[4], r.args[5]);
+			continue;
+		}
+		trace_fix_strings(&r);
+		pp_printf("%d.%03d ", r.tics / TICS_PER_SECOND,
+			  r.tics % TICS_PER_SECOND);
+		pp_printf(r.fmt, r.args[0], r.args[1], r.args[2], r.args[3],
+			  r.args[4], r.args[5]);
+		if (r.nargs > TRACE_BIN_ARGS)
+			pp_printf("  (%d arguments lost)\n",
+				  r.nargs - TRACE_BIN_ARGS);
+	}
+	if (count > CONFIG_TRACE_BIN_ENTRIES)
+		pp_printf("(%d older records overwritten)\n",
+			  count - CONFIG_TRACE_BIN_ENTRIES);
+}
+
+void trace_clear(void)
+{
+	uint32_t ie;
+
+	ie = irq_save();
+	trace.next = 0;
+	trace.count = 0;
+	irq_restore(ie);
+}
@@ -0,0 +1,88 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <string.h>
+
+#include "ipv4.h"
+
+#define IP_VERSION	0
+#define IP_TOS		(IP_VERSION+1)
+#define IP_LEN		(IP_TOS+1)
+#define IP_ID		(IP_LEN+2)
+#define IP_FLAGS	(IP_ID+2)
+#define IP_TTL		(IP_FLAGS+2)
+#define IP_PROTOCOL	(IP_TTL+1)
+#define IP_CHECKSUM	(IP_PROTOCOL+1)
+#define IP_SOURCE	(IP_CHECKSUM+2)
+#define IP_DEST		(IP_SOURCE+4)
+#define IP_END		(IP_DEST+4)
+
+#define UDP_SPORT	(IP_END)
+#define UDP_DPORT	(UDP_SPORT+2)
+#define UDP_LENGTH	(UDP_DPORT+2)
+#define UDP_CHECKSUM	(UDP_LENGTH+2)
+#define UDP_END		(UDP_CHECKSUM+2)
+
+/*
+ * Fill the IP and UDP headers in front of "len" bytes of payload,
+ * that the caller already placed at buf + UDP_HDR_LEN.
+ * Returns the frame length, to be passed to ipv4_send().
+ */
+int udp_build(uint8_t *buf, int len, const uint8_t *dst_ip,
+	      int sport, int dport)
+{
+	uint8_t pseudo[4];
+	uint32_t sum;
+	uint16_t csum;
+	int udplen = len + UDP_END - IP_END;
+	int iplen = len + UDP_END;
+
+	// ------------ IP --------------
+	buf[IP_VERSION] = 0x45;
+	buf[IP_TOS] = 0;
+	buf[IP_LEN + 0] = iplen >> 8;
+	buf[IP_LEN + 1] = iplen & 0xff;
+	buf[IP_ID + 0] = 0;
+	buf[IP_ID + 1] = 0;
+	buf[IP_FLAGS + 0] = 0;
+	buf[IP_FLAGS + 1] = 0;
+	buf[IP_TTL] = 63;
+	buf[IP_PROTOCOL] = 17;	/* UDP */
+	buf[IP_CHECKSUM + 0] = 0;
+	buf[IP_CHECKSUM + 1] = 0;
+	getIP(buf + IP_SOURCE);
+	memcpy(buf + IP_DEST, dst_ip, 4);
+
+	csum = ipv4_checksum((unsigned short *)(buf + IP_VERSION),
+			     (IP_END - IP_VERSION) / 2);
+	buf[IP_CHECKSUM + 0] = csum >> 8;
+	buf[IP_CHECKSUM + 1] = csum & 0xff;
+
+	// ------------ UDP -------------
+	buf[UDP_SPORT + 0] = sport >> 8;
+	buf[UDP_SPORT + 1] = sport & 0xff;
+	buf[UDP_DPORT + 0] = dport >> 8;
+	buf[UDP_DPORT + 1] = dport & 0xff;
+	buf[UDP_LENGTH + 0] = udplen >> 8;
+	buf[UDP_LENGTH + 1] = udplen & 0xff;
+	buf[UDP_CHECKSUM + 0] = 0;
+	buf[UDP_CHECKSUM + 1] = 0;
+
+	/* Pseudo header: addresses from the IP header, then these 4 bytes */
+	pseudo[0] = 0;
+	pseudo[1] = 17;
+	pseudo[2] = udplen >> 8;
+	pseudo[3] = udplen & 0xff;
+	sum = ipv4_csum_partial(buf + IP_SOURCE, 8, 0);
+	sum = ipv4_csum_partial(pseudo, 4, sum);
+	sum = ipv4_csum_partial(buf + UDP_SPORT, udplen, sum);
+	csum = ipv4_csum_fold(sum);
+	if (csum == 0)
+		csum = 0xffff;
+	buf[UDP_CHECKSUM + 0] = csum >> 8;
+	buf[UDP_CHECKSUM + 1] = csum & 0xff;
+
+	return iplen;
+}
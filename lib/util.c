@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <string.h>
 #include <time.h>
 #include <wrc.h>
 
@@ -103,3 +104,140 @@ void term_clear()
 {
 	mprintf("\e[2J\e[1;1H");
 }
+
+/*
+ * A screen made of fields, for the monitor. A field is printed only
+ * when its text or color differ from what the terminal shows, so a
+ * refresh only sends the values that changed. We keep a hash of each
+ * field, not its text. Fields that are not printed between
+ * scr_begin() and scr_end() are erased, so the layout may change.
+ */
+#define SCR_FIELDS	64
+
+static struct scr_field {
+	uint8_t row, col, len, seen;
+	uint32_t hash;
+} scr_fields[SCR_FIELDS];
+static int scr_nfields = -1; /* the terminal must be cleared */
+
+static const char scr_spaces[] =
+	"                                                                ";
+
+void scr_invalidate(void)
+{
+	scr_nfields = -1;
+}
+
+void scr_begin(void)
+{
+	int i;
+
+	if (scr_nfields < 0) {
+		term_clear();
+		scr_nfields = 0;
+	}
+	for (i = 0; i < scr_nfields; i++)
+		scr_fields[i].seen = 0;
+}
+
+static uint32_t scr_hash(int color, const char *s)
+{
+	uint32_t h = 2166136261U ^ color; /* FNV-1a */
+
+	while (*s) {
+		h ^= (uint8_t)*s++;
+		h *= 16777619;
+	}
+	return h;
+}
+
+static void scr_blank(int row, int col, int n)
+{
+	int i;
+
+	mprintf("\e[%d;%df", row, col);
+	for (i = sizeof(scr_spaces) - 1; n > 0; n -= i) {
+		if (i > n)
+			i = n;
+		mprintf("%s", scr_spaces + sizeof(scr_spaces) - 1 - i);
+	}
+}
+
+void scr_printf(int row, int col, int color, const char *fmt, ...)
+{
+	static char buf[CONFIG_PRINT_BUFSIZE];
+	struct scr_field *f;
+	va_list ap;
+	uint32_t hash;
+	int i, len, pad = 0;
+
+	va_start(ap, fmt);
+	pp_vsprintf(buf, fmt, ap);
+	va_end(ap);
+	len = strlen(buf);
+	hash = scr_hash(color, buf);
+
+	for (i = 0, f = scr_fields; i < scr_nfields; i++, f++)
+		if (f->row == row && f->col == col)
+			break;
+	if (i == scr_nfields) {
+		if (scr_nfields == SCR_FIELDS) {
+			f = NULL; /* no room: always print it */
+		} else {
+			scr_nfields++;
+			f->row = row;
+			f->col = col;
+			f->len = 0;
+			f->hash = ~hash;
+		}
+	}
+	if (f) {
+		f->seen = 1;
+		if (f->hash == hash && f->len == len)
+			return;
+		pad = f->len - len;
+		f->hash = hash;
+		f->len = len;
+	}
+	pcprintf(row, col, color, "%s", buf);
+	if (pad > 0)
+		scr_blank(row, col + len, pad);
+}
+
+/* Is this column covered by a field printed in this refresh? */
+static int scr_covered(int row, int col)
+{
+	struct scr_field *f;
+	int i;
+
+	for (i = 0, f = scr_fields; i < scr_nfields; i++, f++)
+		if (f->seen && f->row == row && col >= f->col
+		    && col < f->col + f->len)
+			return 1;
+	return 0;
+}
+
+void scr_end(int row)
+{
+	struct scr_field *f;
+	int i, c, start;
+
+	for (i = 0; i < scr_nfields; ) {
+		f = scr_fields + i;
+		if (f->seen) {
+			i++;
+			continue;
+		}
+		/* Erase it, except where a new field is already printed */
+		for (c = start = f->col; c <= f->col + f->len; c++) {
+			if (c < f->col + f->len && !scr_covered(f->row, c))
+				continue;
+			if (c > start)
+				scr_blank(f->row, start, c - start);
+			start = c + 1;
+		}
+		*f = scr_fields[--scr_nfields];
+	}
+	/* Leave the cursor below the screen */
+	mprintf("\e[%d;1f", row);
+}
@@ -8,6 +8,7 @@
  */
 
 #include <inttypes.h>
+#include <string.h>
 #include <wrc.h>
 #include <w1.h>
 #include <ppsi/ppsi.h>
@@ -22,6 +23,7 @@
 #include "wrc_ptp.h"
 #include "hal_exports.h"
 #include "lib/ipv4.h"
+#include "stat-bin.h"
 
 struct ptpdexp_sync_state_t;
 extern ptpdexp_sync_state_t cur_servo_state;
@@ -33,21 +35,14 @@ struct pp_instance *ppi = &ppi_static;
 
 static void wrc_mon_std_servo(void);
 
-#define PRINT64_FACTOR	1000000000LL
-char* print64(uint64_t x)
-{
-	uint32_t h_half, l_half;
-	static char buf[2*10+1];	//2x 32-bit value + \0
-	if (x < PRINT64_FACTOR)
-		sprintf(buf, "%u", (uint32_t)x);
-	else{
-		l_half = __div64_32(&x, PRINT64_FACTOR);
-		h_half = (uint32_t) x;
-		sprintf(buf, "%u%u", h_half, l_half);
-	}
-	return buf;
 
-}
+/*
+ * The screen is drawn with scr_printf(): labels are printed once, and
+ * later refreshes only send the values that changed. Labels are in
+ * column 1, values in column VAL (VAL_T for the timing parameters).
+ */
+#define VAL	28
+#define VAL_T	26
 
 int wrc_mon_status()
 {
@@ -57,27 +52,88 @@ int wrc_mon_status()
 			break;
 	}
 
-	cprintf(C_BLUE, "\n\nPTP status: ");
-	cprintf(C_WHITE, "%s", ip ? ip->name : "unknown");
+	scr_printf(11, 1, C_BLUE, "PTP status:");
+	scr_printf(11, VAL, C_WHITE, "%s", ip ? ip->name : "unknown");
 
 	if ((!cur_servo_state.valid) || (ppi->state != PPS_SLAVE)) {
-		cprintf(C_RED,
-			"\n\nSync info not valid\n\n");
+		scr_printf(13, 1, C_RED, "Sync info not valid");
 		return 0;
 	}
 
 	/* show_servo */
-	cprintf(C_BLUE, "\n\nSynchronization status:\n\n");
+	scr_printf(13, 1, C_BLUE, "Synchronization status:");
 
 	return 1;
 }
 
+static void wrc_mon_wr_servo(void)
+{
+	int aux_stat;
+
+	scr_printf(15, 1, C_GREY, "Servo state:");
+	scr_printf(15, VAL, C_WHITE, "%s", cur_servo_state.slave_servo_state);
+	scr_printf(16, 1, C_GREY, "Phase tracking:");
+	if (cur_servo_state.tracking_enabled)
+		scr_printf(16, VAL, C_GREEN, "ON");
+	else
+		scr_printf(16, VAL, C_RED, "OFF");
+	scr_printf(17, 1, C_GREY, "Synchronization source:");
+	scr_printf(17, VAL, C_WHITE, "%s", cur_servo_state.sync_source);
+
+	scr_printf(18, 1, C_GREY, "Aux clock status:");
+	aux_stat = spll_get_aux_status(0);
+	scr_printf(18, VAL, C_GREEN, "%s%s",
+		   aux_stat & SPLL_AUX_ENABLED ? "enabled" : "",
+		   aux_stat & SPLL_AUX_LOCKED ? ", locked" : "");
+
+	scr_printf(20, 1, C_BLUE, "Timing parameters:");
+
+	scr_printf(22, 1, C_GREY, "Round-trip time (mu):");
+	scr_printf(22, VAL_T, C_WHITE, "%lld ps",
+		   (long long)cur_servo_state.mu);
+	scr_printf(23, 1, C_GREY, "Master-slave delay:");
+	scr_printf(23, VAL_T, C_WHITE, "%lld ps",
+		   (long long)cur_servo_state.delay_ms);
+	scr_printf(24, 1, C_GREY, "Master PHY delays:");
+	scr_printf(24, VAL_T, C_WHITE, "TX: %d ps, RX: %d ps",
+		   (int32_t) cur_servo_state.delta_tx_m,
+		   (int32_t) cur_servo_state.delta_rx_m);
+	scr_printf(25, 1, C_GREY, "Slave PHY delays:");
+	scr_printf(25, VAL_T, C_WHITE, "TX: %d ps, RX: %d ps",
+		   (int32_t) cur_servo_state.delta_tx_s,
+		   (int32_t) cur_servo_state.delta_rx_s);
+	scr_printf(26, 1, C_GREY, "Total link asymmetry:");
+	scr_printf(26, VAL_T, C_WHITE, "%9d ps",
+		   (int32_t) (cur_servo_state.total_asymmetry));
+	scr_printf(27, 1, C_GREY, "Cable rtt delay:");
+	scr_printf(27, VAL_T, C_WHITE, "%lld ps",
+		   (long long)(cur_servo_state.mu -
+					cur_servo_state.delta_tx_m -
+					cur_servo_state.delta_rx_m -
+					cur_servo_state.delta_tx_s -
+					cur_servo_state.delta_rx_s));
+	scr_printf(28, 1, C_GREY, "Clock offset:");
+	scr_printf(28, VAL_T, C_WHITE, "%9d ps",
+		   (int32_t) (cur_servo_state.cur_offset));
+	scr_printf(29, 1, C_GREY, "Phase setpoint:");
+	scr_printf(29, VAL_T, C_WHITE, "%9d ps",
+		   (int32_t) (cur_servo_state.cur_setpoint));
+	scr_printf(30, 1, C_GREY, "Skew:");
+	scr_printf(30, VAL_T, C_WHITE, "%9d ps",
+		   (int32_t) (cur_servo_state.cur_skew));
+	scr_printf(31, 1, C_GREY, "Manual phase adjustment:");
+	scr_printf(31, VAL_T, C_WHITE, "%9d ps", (int32_t) (wrc_man_phase));
+
+	scr_printf(32, 1, C_GREY, "Update counter:");
+	scr_printf(32, VAL_T, C_WHITE, "%9d",
+		   (int32_t) (cur_servo_state.update_count));
+}
+
 void wrc_mon_gui(void)
 {
 	static uint32_t last;
 	hexp_port_state_t ps;
 	int tx, rx;
-	int aux_stat;
 	uint64_t sec;
 	uint32_t nsec;
 #ifdef CONFIG_ETHERBONE
@@ -91,171 +147,118 @@ void wrc_mon_gui(void)
 
 	last = timer_get_tics();
 
-	term_clear();
+	scr_begin();
 
-	pcprintf(1, 1, C_BLUE, "WR PTP Core Sync Monitor v 1.0");
-	pcprintf(2, 1, C_GREY, "Esc = exit");
+	scr_printf(1, 1, C_BLUE, "WR PTP Core Sync Monitor v 1.0");
+	scr_printf(2, 1, C_GREY, "Esc = exit");
 
 	shw_pps_gen_get_time(&sec, &nsec);
 
-	cprintf(C_BLUE, "\n\nTAI Time:                  ");
-	cprintf(C_WHITE, "%s", format_time(sec));
+	scr_printf(4, 1, C_BLUE, "TAI Time:");
+	scr_printf(4, VAL, C_WHITE, "%s", format_time(sec));
 
 	/*show_ports */
 	halexp_get_port_state(&ps, NULL);
-	pcprintf(4, 1, C_BLUE, "\n\nLink status:");
+	scr_printf(6, 1, C_BLUE, "Link status:");
 
-	pcprintf(6, 1, C_WHITE, "%s: ", "wru1");
+	scr_printf(7, 1, C_WHITE, "%s:", "wru1");
 	if (ps.up)
-		cprintf(C_GREEN, "Link up   ");
+		scr_printf(7, 7, C_GREEN, "Link up");
 	else
-		cprintf(C_RED, "Link down ");
+		scr_printf(7, 7, C_RED, "Link down");
 
 	if (ps.up) {
 		minic_get_stats(&tx, &rx);
-		cprintf(C_GREY, "(RX: %d, TX: %d), mode: ", rx, tx);
+		scr_printf(7, 17, C_GREY, "(RX: %d, TX: %d)", rx, tx);
+		scr_printf(8, 1, C_WHITE, "mode:");
 
 		if (!WR_DSPOR(ppi)->wrModeOn) {
 			wrc_mon_std_servo();
-			return;
+			goto out;
 		}
 
 		switch (ptp_mode) {
 		case WRC_MODE_GM:
 		case WRC_MODE_MASTER:
-			cprintf(C_WHITE, "WR Master  ");
+			scr_printf(8, 7, C_WHITE, "WR Master");
 			break;
 		case WRC_MODE_SLAVE:
-			cprintf(C_WHITE, "WR Slave   ");
+			scr_printf(8, 7, C_WHITE, "WR Slave");
 			break;
 		default:
-			cprintf(C_RED, "WR Unknown   ");
+			scr_printf(8, 7, C_RED, "WR Unknown");
 		}
 
 		if (ps.is_locked)
-			cprintf(C_GREEN, "Locked  ");
+			scr_printf(8, 19, C_GREEN, "Locked");
 		else
-			cprintf(C_RED, "NoLock  ");
+			scr_printf(8, 19, C_RED, "NoLock");
 		if (ps.rx_calibrated && ps.tx_calibrated)
-			cprintf(C_GREEN, "Calibrated  ");
+			scr_printf(8, 27, C_GREEN, "Calibrated");
 		else
-			cprintf(C_RED, "Uncalibrated  ");
+			scr_printf(8, 27, C_RED, "Uncalibrated");
 #ifdef CONFIG_ETHERBONE
-		cprintf(C_WHITE, "\nIPv4: ");
+		scr_printf(9, 1, C_WHITE, "IPv4:");
 		getIP(ip);
 		if (needIP)
-			cprintf(C_RED, "BOOTP running");
+			scr_printf(9, 7, C_RED, "BOOTP running");
 		else
-			cprintf(C_GREEN, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+			scr_printf(9, 7, C_GREEN, "%d.%d.%d.%d",
+				   ip[0], ip[1], ip[2], ip[3]);
 #endif
 
-		if (wrc_mon_status() == 0)
-			return;
-
-		cprintf(C_GREY, "Servo state:               ");
-		cprintf(C_WHITE, "%s\n", cur_servo_state.slave_servo_state);
-		cprintf(C_GREY, "Phase tracking:            ");
-		if (cur_servo_state.tracking_enabled)
-			cprintf(C_GREEN, "ON\n");
-		else
-			cprintf(C_RED, "OFF\n");
-		cprintf(C_GREY, "Synchronization source:    ");
-		cprintf(C_WHITE, "%s\n", cur_servo_state.sync_source);
-
-		cprintf(C_GREY, "Aux clock status:          ");
-
-		aux_stat = spll_get_aux_status(0);
-
-		if (aux_stat & SPLL_AUX_ENABLED)
-			cprintf(C_GREEN, "enabled");
-
-		if (aux_stat & SPLL_AUX_LOCKED)
-			cprintf(C_GREEN, ", locked");
-		mprintf("\n");
-
-		cprintf(C_BLUE, "\nTiming parameters:\n\n");
-
-		cprintf(C_GREY, "Round-trip time (mu):    ");
-		cprintf(C_WHITE, "%s ps\n", print64(cur_servo_state.mu));
-		cprintf(C_GREY, "Master-slave delay:      ");
-		cprintf(C_WHITE, "%s ps\n", print64(cur_servo_state.delay_ms));
-		cprintf(C_GREY, "Master PHY delays:       ");
-		cprintf(C_WHITE, "TX: %d ps, RX: %d ps\n",
-			(int32_t) cur_servo_state.delta_tx_m,
-			(int32_t) cur_servo_state.delta_rx_m);
-		cprintf(C_GREY, "Slave PHY delays:        ");
-		cprintf(C_WHITE, "TX: %d ps, RX: %d ps\n",
-			(int32_t) cur_servo_state.delta_tx_s,
-			(int32_t) cur_servo_state.delta_rx_s);
-		cprintf(C_GREY, "Total link asymmetry:    ");
-		cprintf(C_WHITE, "%9d ps\n",
-			(int32_t) (cur_servo_state.total_asymmetry));
-		cprintf(C_GREY, "Cable rtt delay:         ");
-		cprintf(C_WHITE, "%s ps\n", print64(cur_servo_state.mu -
-					cur_servo_state.delta_tx_m -
-					cur_servo_state.delta_rx_m -
-					cur_servo_state.delta_tx_s -
-					cur_servo_state.delta_rx_s));
-		cprintf(C_GREY, "Clock offset:            ");
-		cprintf(C_WHITE, "%9d ps\n",
-			(int32_t) (cur_servo_state.cur_offset));
-		cprintf(C_GREY, "Phase setpoint:          ");
-		cprintf(C_WHITE, "%9d ps\n",
-			(int32_t) (cur_servo_state.cur_setpoint));
-		cprintf(C_GREY, "Skew:                    ");
-		cprintf(C_WHITE, "%9d ps\n",
-			(int32_t) (cur_servo_state.cur_skew));
-		cprintf(C_GREY, "Manual phase adjustment: ");
-		cprintf(C_WHITE, "%9d ps\n", (int32_t) (wrc_man_phase));
-
-		cprintf(C_GREY, "Update counter:          ");
-		cprintf(C_WHITE, "%9d \n",
-			(int32_t) (cur_servo_state.update_count));
-
+		if (wrc_mon_status())
+			wrc_mon_wr_servo();
 	}
 
-	pp_printf("--");
-
-	return;
+out:
+	scr_printf(34, 1, C_GREY, "--");
+	scr_end(35);
 }
 
-static inline void cprintf_ti(int color, struct TimeInternal *ti)
+static inline void scr_printf_ti(int row, int col, int color,
+				 struct TimeInternal *ti)
 {
 	if ((ti->seconds > 0) ||
 		((ti->seconds == 0) && (ti->nanoseconds >= 0)))
-		cprintf(color, "%2i.%09i s", ti->seconds, ti->nanoseconds);
+		scr_printf(row, col, color, "%2i.%09i s", ti->seconds,
+			   ti->nanoseconds);
 	else {
 		if (ti->seconds == 0)
-			cprintf(color, "-%i.%09i s", ti->seconds, -ti->nanoseconds);
+			scr_printf(row, col, color, "-%i.%09i s", ti->seconds,
+				   -ti->nanoseconds);
 		else
-			cprintf(color, "%2i.%09i s", ti->seconds, -ti->nanoseconds);
+			scr_printf(row, col, color, "%2i.%09i s", ti->seconds,
+				   -ti->nanoseconds);
 	}
 
 }
 
 static void wrc_mon_std_servo(void)
 {
-	cprintf(C_RED, "WR Off");
+	scr_printf(8, 7, C_RED, "WR Off");
 
 	if (wrc_mon_status() == 0)
 		return;
 
-	cprintf(C_GREY, "Clock offset:                 ");
+	scr_printf(15, 1, C_GREY, "Clock offset:");
 
 	if (DSCUR(ppi)->offsetFromMaster.seconds)
-		cprintf_ti(C_WHITE, &DSCUR(ppi)->offsetFromMaster);
+		scr_printf_ti(15, VAL + 3, C_WHITE,
+			      &DSCUR(ppi)->offsetFromMaster);
 	else {
-		cprintf(C_WHITE, "%9i ns", DSCUR(ppi)->offsetFromMaster.nanoseconds);
+		scr_printf(15, VAL + 3, C_WHITE, "%9i ns",
+			   DSCUR(ppi)->offsetFromMaster.nanoseconds);
 
-		cprintf(C_GREY, "\nOne-way delay averaged:       ");
-		cprintf(C_WHITE, "%9i ns", DSCUR(ppi)->meanPathDelay.nanoseconds);
+		scr_printf(16, 1, C_GREY, "One-way delay averaged:");
+		scr_printf(16, VAL + 3, C_WHITE, "%9i ns",
+			   DSCUR(ppi)->meanPathDelay.nanoseconds);
 
-		cprintf(C_GREY, "\nObserved drift:               ");
-		cprintf(C_WHITE, "%9i ns", SRV(ppi)->obs_drift);
+		scr_printf(17, 1, C_GREY, "Observed drift:");
+		scr_printf(17, VAL + 3, C_WHITE, "%9i ns", SRV(ppi)->obs_drift);
 	}
 }
 
-
 int wrc_log_stats(uint8_t onetime)
 {
 	static uint32_t last;
@@ -272,6 +275,13 @@ int wrc_log_stats(uint8_t onetime)
 
 	last = timer_get_tics();
 
+#ifdef CONFIG_STAT_BIN
+	if (wrc_stat_bin) {
+		wrc_log_stats_bin();
+		return 0;
+	}
+#endif
+
 	shw_pps_gen_get_time(&sec, &nsec);
 	halexp_get_port_state(&ps, NULL);
 	minic_get_stats(&tx, &rx);
@@ -282,14 +292,14 @@ int wrc_log_stats(uint8_t onetime)
 	aux_stat = spll_get_aux_status(0);
 	pp_printf("aux:%x ", aux_stat);
 	pp_printf("sec:%d nsec:%d ", (uint32_t) sec, nsec);	/* fixme: clock is not always 125 MHz */
-	pp_printf("mu:%s ", print64(cur_servo_state.mu));
-	pp_printf("dms:%s ", print64(cur_servo_state.delay_ms));
+	pp_printf("mu:%lld ", (long long)cur_servo_state.mu);
+	pp_printf("dms:%lld ", (long long)cur_servo_state.delay_ms);
 	pp_printf("dtxm:%d drxm:%d ", (int32_t) cur_servo_state.delta_tx_m,
 		(int32_t) cur_servo_state.delta_rx_m);
 	pp_printf("dtxs:%d drxs:%d ", (int32_t) cur_servo_state.delta_tx_s,
 		(int32_t) cur_servo_state.delta_rx_s);
 	pp_printf("asym:%d ", (int32_t) (cur_servo_state.total_asymmetry));
-	pp_printf("crtt:%s ", print64(cur_servo_state.mu -
+	pp_printf("crtt:%lld ", (long long)(cur_servo_state.mu -
 				cur_servo_state.delta_tx_m -
 				cur_servo_state.delta_rx_m -
 				cur_servo_state.delta_tx_s -
@@ -303,11 +313,8 @@ int wrc_log_stats(uint8_t onetime)
 	if (1) {
 		int32_t temp;
 
-		//first read the value from previous measurement,
-		//first one will be random, I know
-		temp = w1_read_temp_bus(&wrpc_w1_bus, W1_FLAG_COLLECT);
-		//then initiate new conversion for next loop cycle
-		w1_read_temp_bus(&wrpc_w1_bus, W1_FLAG_NOWAIT);
+		/* the cached reading, see w1_temp_poll() */
+		temp = w1_temp_get(0, NULL);
 		pp_printf("temp: %d.%04d C", temp >> 16,
 			  (int)((temp & 0xffff) * 10 * 1000 >> 16));
 	}
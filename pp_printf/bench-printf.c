@@ -0,0 +1,61 @@
+/*
+ * Host benchmark for the vsprintf engines: time pp_sprintf() on a few
+ * formats, 32-bit and 64-bit. Built once per engine by "make bench",
+ * that also prints the code size of each engine.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <pp-printf.h>
+
+#define LOOPS 200000
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define cycles() __rdtsc()
+#else
+#define cycles() 0ULL
+#endif
+
+static char buf[256];
+static volatile int v32 = -123456789;
+static volatile long long v64 = 1000000005LL * 1000 + 123;
+
+static void bench_32(void)
+{
+	pp_sprintf(buf, "%d %u %x %09u", v32, v32, v32, 5);
+}
+
+static void bench_64(void)
+{
+	pp_sprintf(buf, "%lld %llx", v64, v64);
+}
+
+static void bench_fixed(void)
+{
+	pp_sprintf(buf, "%'lld ns", v64);
+}
+
+static void run(const char *name, void (*f)(void))
+{
+	struct timespec t0, t1;
+	unsigned long long c0, c1;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	c0 = cycles();
+	for (i = 0; i < LOOPS; i++)
+		f();
+	c1 = cycles();
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	printf("  %-6s %6.1f ns %7.1f cycles  \"%s\"\n", name,
+	       ((t1.tv_sec - t0.tv_sec) * 1e9 + t1.tv_nsec - t0.tv_nsec)
+	       / LOOPS, (double)(c1 - c0) / LOOPS, buf);
+}
+
+int main(int argc, char **argv)
+{
+	run("32-bit", bench_32);
+	run("64-bit", bench_64);
+	run("fixed", bench_fixed);
+	return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Division by 10 with shifts and adds, for the vsprintf engines.
+ * The quotient is estimated as n * 0.8 / 8, where 0.8 is 0.1100 1100...
+ * in binary; the estimate is at most one less than the real quotient,
+ * and the remainder tells (see "Hacker's Delight", divu10). This
+ * avoids the libgcc division, that is slow on cpus with no divider,
+ * and for 64 bits it costs a few 32-bit operations per step.
+ *
+ * public domain
+ */
+#include <stdint.h>
+
+static inline uint32_t pp_div10(uint32_t n, int *rem)
+{
+	uint32_t q, r;
+
+	q = (n >> 1) + (n >> 2);
+	q += q >> 4;
+	q += q >> 8;
+	q += q >> 16;
+	q >>= 3;
+	r = n - ((q << 3) + (q << 1));
+	if (r > 9) {
+		q++;
+		r -= 10;
+	}
+	*rem = r;
+	return q;
+}
+
+static inline uint64_t pp_div10_64(uint64_t n, int *rem)
+{
+	uint64_t q;
+	uint32_t r;
+
+	q = (n >> 1) + (n >> 2);
+	q += q >> 4;
+	q += q >> 8;
+	q += q >> 16;
+	q += q >> 32;
+	q >>= 3;
+	r = (uint32_t)n - (((uint32_t)q << 3) + ((uint32_t)q << 1));
+	if (r > 9) {
+		q++;
+		r -= 10;
+	}
+	*rem = r;
+	return q;
+}
+
+/*
+ * Write the decimal digits of n backwards, before "end"; return a
+ * pointer to the first digit. The 64-bit loop only runs while the
+ * value doesn't fit 32 bits.
+ */
+static inline char *pp_put_dec(char *end, uint64_t n)
+{
+	uint32_t n32;
+	int rem;
+
+	while (n >> 32) {
+		n = pp_div10_64(n, &rem);
+		*--end = rem + '0';
+	}
+	n32 = n;
+	do {
+		n32 = pp_div10(n32, &rem);
+		*--end = rem + '0';
+	} while (n32);
+	return end;
+}
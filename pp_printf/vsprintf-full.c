@@ -17,6 +17,7 @@
 
 /* BEGIN OF HACKS */
 #include <pp-printf.h>
+#include "div10.h"
 
 /* <ctype.h> */
 static inline int isdigit(int c)
@@ -121,59 +122,25 @@ static char* put_dec_trunc(char *buf, unsigned q)
 	}
 	return buf;
 }
-/* Same with if's removed. Always emits five digits */
-static char* put_dec_full(char *buf, unsigned q)
+/*
+ * Digits are extracted one at a time, with no division (see div10.h),
+ * down to five digits; 64-bit steps are only used for large values.
+ */
+static noinline char* put_dec(char *buf, unsigned long long num)
 {
-	/* BTW, if q is in [0,9999], 8-bit ints will be enough, */
-	/* but anyway, gcc produces better code with full-sized ints */
-	unsigned d3, d2, d1, d0;
-	d1 = (q>>4) & 0xf;
-	d2 = (q>>8) & 0xf;
-	d3 = (q>>12);
-
-	/*
-	 * Possible ways to approx. divide by 10
-	 * gcc -O2 replaces multiply with shifts and adds
-	 * (x * 0xcd) >> 11: 11001101 - shorter code than * 0x67 (on i386)
-	 * (x * 0x67) >> 10:  1100111
-	 * (x * 0x34) >> 9:    110100 - same
-	 * (x * 0x1a) >> 8:     11010 - same
-	 * (x * 0x0d) >> 7:      1101 - same, shortest code (on i386)
-	 */
-
-	d0 = 6*(d3 + d2 + d1) + (q & 0xf);
-	q = (d0 * 0xcd) >> 11;
-	d0 = d0 - 10*q;
-	*buf++ = d0 + '0';
-	d1 = q + 9*d3 + 5*d2 + d1;
-		q = (d1 * 0xcd) >> 11;
-		d1 = d1 - 10*q;
-		*buf++ = d1 + '0';
+	unsigned n32;
+	int rem;
 
-		d2 = q + 2*d2;
-			q = (d2 * 0xd) >> 7;
-			d2 = d2 - 10*q;
-			*buf++ = d2 + '0';
-
-			d3 = q + 4*d3;
-				q = (d3 * 0xcd) >> 11; /* - shorter code */
-				/* q = (d3 * 0x67) >> 10; - would also work */
-				d3 = d3 - 10*q;
-				*buf++ = d3 + '0';
-					*buf++ = q + '0';
-	return buf;
-}
-/* No inlining helps gcc to use registers better */
-static noinline char* put_dec(char *buf, unsigned long num)
-{
-	while (1) {
-		unsigned rem;
-		if (num < 100000)
-			return put_dec_trunc(buf, num);
-		rem = num % 100000;
-		num /= 100000;
-		buf = put_dec_full(buf, rem);
+	while (num >> 32) {
+		num = pp_div10_64(num, &rem);
+		*buf++ = rem + '0';
 	}
+	n32 = num;
+	while (n32 >= 100000) {
+		n32 = pp_div10(n32, &rem);
+		*buf++ = rem + '0';
+	}
+	return put_dec_trunc(buf, n32);
 }
 
 #define ZEROPAD	1		/* pad with zero */
@@ -183,8 +150,9 @@ static noinline char* put_dec(char *buf, unsigned long num)
 #define LEFT	16		/* left justified */
 #define SMALL	32		/* Must be 32 == 0x20 */
 #define SPECIAL	64		/* 0x */
+#define FIXED	128		/* "'": 3 decimals, e.g. ps as ns */
 
-static char *number(char *buf, unsigned long num, int base, int size, int precision, int type)
+static char *number(char *buf, unsigned long long num, int base, int size, int precision, int type)
 {
 	/* we are called with base 8, 10 or 16, only, thus don't need "G..."  */
 	static const char digits[16] = "0123456789ABCDEF"; /* "GHIJKLMNOPQRSTUVWXYZ"; */
@@ -202,9 +170,9 @@ static char *number(char *buf, unsigned long num, int base, int size, int precis
 		type &= ~ZEROPAD;
 	sign = 0;
 	if (type & SIGN) {
-		if ((signed long) num < 0) {
+		if ((signed long long) num < 0) {
 			sign = '-';
-			num = - (signed long) num;
+			num = - (signed long long) num;
 			size--;
 		} else if (type & PLUS) {
 			sign = '+';
@@ -240,6 +208,14 @@ static char *number(char *buf, unsigned long num, int base, int size, int precis
 	} else { /* base 10 */
 		i = put_dec(tmp, num) - tmp;
 	}
+	if ((type & FIXED) && base == 10) {
+		/* digits are reversed: the point goes after three */
+		while (i < 4)
+			tmp[i++] = '0';
+		memmove(tmp + 4, tmp + 3, i - 3);
+		tmp[3] = '.';
+		i++;
+	}
 
 	/* printing 100 using %2d gives "100", not "00" */
 	if (i > precision)
@@ -422,7 +398,7 @@ static char *pointer(const char *fmt, char *buf, void *ptr, int field_width, int
  */
 int pp_vsprintf(char *buf, const char *fmt, va_list args)
 {
-	unsigned long num;
+	unsigned long long num;
 	int base;
 	char *str;
 
@@ -454,6 +430,7 @@ int pp_vsprintf(char *buf, const char *fmt, va_list args)
 				case ' ': flags |= SPACE; goto repeat;
 				case '#': flags |= SPECIAL; goto repeat;
 				case '0': flags |= ZEROPAD; goto repeat;
+				case '\'': flags |= FIXED; goto repeat;
 			}
 
 		/* get field width */
@@ -562,12 +539,9 @@ int pp_vsprintf(char *buf, const char *fmt, va_list args)
 				--fmt;
 			continue;
 		}
-#ifdef CONFIG_SYS_64BIT_VSPRINTF
-		if (qualifier == 'L')  /* "quad" for 64 bit variables */
+		if (qualifier == 'L') { /* "quad" for 64 bit variables */
 			num = va_arg(args, unsigned long long);
-		else
-#endif
-		if (qualifier == 'l') {
+		} else if (qualifier == 'l') {
 			num = va_arg(args, unsigned long);
 			if (flags & SIGN)
 				num = (signed long) num;
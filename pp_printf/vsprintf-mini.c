@@ -6,7 +6,8 @@
  */
 int pp_vsprintf(char *buf, const char *fmt, va_list args)
 {
-	int i, j;
+	int j, lng;
+	unsigned long long v;
 	static char hex[] = "0123456789abcdef";
 	char *s;
 	char *str = buf;
@@ -17,6 +18,7 @@ int pp_vsprintf(char *buf, const char *fmt, va_list args)
 			continue;
 		}
 
+		lng = 0;
 	repeat:
 		fmt++;		/* Skip '%' initially, other stuff later */
 
@@ -24,9 +26,12 @@ int pp_vsprintf(char *buf, const char *fmt, va_list args)
 		switch(*fmt) {
 		case '\0':
 			goto ret;
+		case 'l':
+			lng++;
+			goto repeat;
 		case '*':
 			/* should be precision, just eat it */
-			i = va_arg(args, int);
+			(void)va_arg(args, int);
 			/* fall through: discard unknown stuff */
 		default:
 			goto repeat;
@@ -48,17 +53,26 @@ int pp_vsprintf(char *buf, const char *fmt, va_list args)
 			break;
 
 			/* all integer (and pointer) are printed as <%08x> */
+		case 'p':
+			if (sizeof(void *) > 4)
+				lng = 2;
 		case 'o':
 		case 'x':
 		case 'X':
 		case 'd':
 		case 'i':
 		case 'u':
-		case 'p':
-			i = va_arg(args, int);
+			/* 64-bit values as <%016x>; "long" too, on 64-bit hosts */
+			if (lng > 1 || (lng && sizeof(long) > 4)) {
+				v = va_arg(args, unsigned long long);
+				j = 60;
+			} else {
+				v = va_arg(args, unsigned int);
+				j = 28;
+			}
 			*str++ = '<';
-			for (j = 28; j >= 0; j -= 4)
-				*str++ = hex[(i>>j)&0xf];
+			for (; j >= 0; j -= 4)
+				*str++ = hex[(v>>j)&0xf];
 			*str++ = '>';
 			break;
 		}
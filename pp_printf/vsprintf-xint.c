@@ -5,43 +5,58 @@
  */
 #include <stdarg.h>
 #include <stdint.h>
+#include "div10.h"
 
 static const char hex[] = "0123456789abcdef";
 
-static int number(char *out, unsigned value, int base, int lead, int wid)
+#define FIXED_DIGITS	3 /* "%'d": a fixed-point value, e.g. ps as ns */
+
+static int number(char *out, uint64_t value, int base, int lead, int wid,
+		  int sign, int fixed)
 {
-	char tmp[16];
-	int i = 16, ret, negative = 0;
+	char tmp[32];
+	char *s = tmp + sizeof(tmp), *end = s, *p;
+	int ret, negative = 0, shift = base == 16 ? 4 : 3;
 
 	/* No error checking at all: it is as ugly as possible */
-	if ((signed)value < 0 && base == 10) {
+	if (sign && (int64_t)value < 0) {
 		negative = 1;
 		value = -value;
 	}
-	while (value && i) {
-		tmp[--i] = hex[value % base];
-		value /= base;
+	if (base == 10) {
+		s = pp_put_dec(s, value);
+	} else {
+		do {
+			*--s = hex[value & (base - 1)];
+			value >>= shift;
+		} while (value);
+	}
+	if (fixed) {
+		while (end - s <= FIXED_DIGITS)
+			*--s = '0';
+		for (p = --s; p < end - FIXED_DIGITS - 1; p++)
+			p[0] = p[1];
+		*p = '.';
 	}
-	if (i == 16)
-		tmp[--i] = '0';
 	if (negative && lead == ' ') {
-		tmp[--i] = '-';
+		*--s = '-';
 		negative = 0;
 	}
-	while (i > 16 - wid + negative)
-		tmp[--i] = lead;
+	while (end - s < wid - negative)
+		*--s = lead;
 	if (negative)
-		tmp[--i] = '-';
-	ret = 16 - i;
-	while (i < 16)
-		*(out++) = tmp[i++];
+		*--s = '-';
+	ret = end - s;
+	while (s < end)
+		*(out++) = *s++;
 	return ret;
 }
 
 int pp_vsprintf(char *buf, const char *fmt, va_list args)
 {
 	char *s, *str = buf;
-	int base, lead, wid;
+	int base, lead, wid, lng, fixed;
+	uint64_t value;
 
 	for (; *fmt ; ++fmt) {
 		if (*fmt != '%') {
@@ -52,6 +67,8 @@ int pp_vsprintf(char *buf, const char *fmt, va_list args)
 		base = 10;
 		lead = ' ';
 		wid = 1;
+		lng = 0;
+		fixed = 0;
 	repeat:
 		fmt++;		/* Skip '%' initially, other stuff later */
 		switch(*fmt) {
@@ -60,10 +77,16 @@ int pp_vsprintf(char *buf, const char *fmt, va_list args)
 		case '0':
 			lead = '0';
 			goto repeat;
+		case 'l':
+			lng++;
+			goto repeat;
+		case '\'':
+			fixed = 1;
+			goto repeat;
 
 		case '*':
 			/* should be precision, just eat it */
-			base = va_arg(args, int);
+			(void)va_arg(args, int);
 			/* fall through: discard unknown stuff */
 		default:
 			if (*fmt >= '1' && *fmt <= '9')
@@ -88,16 +111,29 @@ int pp_vsprintf(char *buf, const char *fmt, va_list args)
 
 			/* integers are more or less printed */
 		case 'p':
+			if (sizeof(void *) > 4)
+				lng = 2;
 		case 'x':
 		case 'X':
 			base = 16;
 		case 'o':
 			if (base == 10) /* yet unchaged */
 				base = 8;
+		case 'u':
+			/* "long" is 64 bits on the host, where we benchmark */
+			if (lng > 1 || (lng && sizeof(long) > 4))
+				value = va_arg(args, unsigned long long);
+			else
+				value = va_arg(args, unsigned int);
+			str += number(str, value, base, lead, wid, 0, fixed);
+			break;
 		case 'd':
 		case 'i':
-		case 'u':
-			str += number(str, va_arg(args, int), base, lead, wid);
+			if (lng > 1 || (lng && sizeof(long) > 4))
+				value = va_arg(args, long long);
+			else
+				value = va_arg(args, int);
+			str += number(str, value, base, lead, wid, 1, fixed);
 			break;
 		}
 	}
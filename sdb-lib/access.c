@@ -48,6 +48,7 @@ int sdbfs_fwrite(struct sdbfs *fs, int offset, void *buf, int count)
 		offset = fs->read_offset;
 	if (offset + count > fs->f_len)
 		count = fs->f_len - offset;
+	sdbfs_index_invalidate(fs, fs->f_offset + offset, count);
 	if (fs->data)
 		memcpy(buf, fs->data + fs->f_offset + offset, count);
 	else
@@ -13,6 +13,8 @@
 
 static struct sdbfs *sdbfs_list;
 
+static int sdbfs_index_build(struct sdbfs *fs);
+
 /* All fields unused by the caller are expected to be zeroed */
 int sdbfs_dev_create(struct sdbfs *fs, int verbose)
 {
@@ -29,6 +31,7 @@ int sdbfs_dev_create(struct sdbfs *fs, int verbose)
 
 	if (verbose)
 		fs->flags |= SDBFS_F_VERBOSE;
+	sdbfs_index_build(fs);
 
 	fs->next = sdbfs_list;
 	sdbfs_list = fs;
@@ -70,13 +73,16 @@ static struct sdb_device *sdbfs_readentry(struct sdbfs *fs,
 	/*
 	 * This function reads an entry from a known good offset. It
 	 * returns the pointer to the entry, which may be stored in
-	 * the fs structure itself. Only touches fs->current_record
+	 * the fs structure itself. Only touches fs->current_record;
+	 * returns NULL if the read fails.
 	 */
 	if (fs->data)
 		return (struct sdb_device *)(fs->data + offset);
 	if (!fs->read)
 		return NULL;
-	fs->read(fs, offset, &fs->current_record, sizeof(fs->current_record));
+	if (fs->read(fs, offset, &fs->current_record,
+		     sizeof(fs->current_record)) != sizeof(fs->current_record))
+		return NULL;
 	return &fs->current_record;
 }
 
@@ -97,6 +103,11 @@ struct sdb_device *sdbfs_scan(struct sdbfs *fs, int newscan)
 			return NULL;
 	}
 	ret = sdbfs_readentry(fs, fs->f_offset);
+	if (!ret) {
+		if (newscan)
+			fs->nleft = 0;
+		return NULL;
+	}
 	if (newscan) {
 		i = (typeof(i))ret;
 		fs->nleft = ntohs(i->sdb_records) - 1;
@@ -134,9 +145,68 @@ int sdbfs_open_name(struct sdbfs *fs, const char *name)
 	return -ENOENT;
 }
 
+/*
+ * The index is built at create time, and again after a write to the
+ * directory invalidated it. It only holds the top-level records.
+ * If a read fails it is left unbuilt, so the next open tries again.
+ */
+static int sdbfs_index_build(struct sdbfs *fs)
+{
+	struct sdb_device *d;
+	int n = 0;
+
+	fs->flags &= ~(SDBFS_F_INDEXED | SDBFS_F_NOINDEX);
+	if (!sdbfs_scan(fs, 1)) /* new scan: get the interconnect */
+		return -EIO;
+	while ( (d = sdbfs_scan(fs, 0)) != NULL) {
+		if (n == SDBFS_INDEX_SIZE) {
+			fs->flags |= SDBFS_F_NOINDEX;
+			return -ENOMEM;
+		}
+		fs->index[n].vid = d->sdb_component.product.vendor_id;
+		fs->index[n].did = d->sdb_component.product.device_id;
+		fs->index[n].offset = fs->f_offset;
+		n++;
+	}
+	if (fs->nleft) /* the scan stopped early: a read failed */
+		return -EIO;
+	fs->nindex = n;
+	fs->flags |= SDBFS_F_INDEXED;
+	return 0;
+}
+
+/* Called by sdbfs_fwrite: forget the index if the write hits a record */
+void sdbfs_index_invalidate(struct sdbfs *fs, unsigned long offset, int count)
+{
+	unsigned long dirlen;
+
+	if (!(fs->flags & SDBFS_F_INDEXED))
+		return;
+	dirlen = (fs->nindex + 1) * sizeof(struct sdb_device);
+	if (offset < fs->entrypoint + dirlen && offset + count > fs->entrypoint)
+		fs->flags &= ~SDBFS_F_INDEXED;
+}
+
 int sdbfs_open_id(struct sdbfs *fs, uint64_t vid, uint32_t did)
 {
 	struct sdb_device *d;
+	int i;
+
+	if (!(fs->flags & (SDBFS_F_INDEXED | SDBFS_F_NOINDEX)))
+		sdbfs_index_build(fs);
+	if (fs->flags & SDBFS_F_INDEXED) {
+		for (i = 0; i < fs->nindex; i++) {
+			if (vid != fs->index[i].vid || did != fs->index[i].did)
+				continue;
+			d = sdbfs_readentry(fs, fs->index[i].offset);
+			if (!d)
+				return -ENOENT;
+			fs->currentp = d;
+			__open(fs);
+			return 0;
+		}
+		/* No match: the index may be stale, so scan anyways */
+	}
 
 	sdbfs_scan(fs, 1); /* new scan: get the interconnect and igore it */
 	while ( (d = sdbfs_scan(fs, 0)) != NULL) {
@@ -12,6 +12,21 @@
 
 #include <sdb.h> /* Please point your "-I" to some sensible place */
 
+/*
+ * The top-level records are indexed by (vendor, device) when the
+ * filesystem is created, so opening by id doesn't rescan the directory.
+ * If there are more records than this, we scan as we used to.
+ */
+#ifndef SDBFS_INDEX_SIZE
+#define SDBFS_INDEX_SIZE	8
+#endif
+
+struct sdbfs_index {
+	uint64_t vid;
+	uint32_t did;
+	uint32_t offset;		/* of the record, not the file */
+};
+
 /*
  * Data structures: please not that the library intself doesn't use
  * malloc, so it's the caller who must deal withallocation/removal.
@@ -43,9 +58,13 @@ struct sdbfs {
 	unsigned long read_offset;
 	unsigned long flags;
 	struct sdbfs *next;
+	struct sdbfs_index index[SDBFS_INDEX_SIZE];
+	int nindex;
 };
 
 #define SDBFS_F_VERBOSE		0x0001
+#define SDBFS_F_INDEXED		0x0002	/* index[] is valid */
+#define SDBFS_F_NOINDEX		0x0004	/* too many records for index[] */
 
 
 /* Defined in glue.c */
@@ -56,6 +75,7 @@ int sdbfs_open_name(struct sdbfs *fs, const char *name);
 int sdbfs_open_id(struct sdbfs *fs, uint64_t vid, uint32_t did);
 int sdbfs_close(struct sdbfs *fs);
 struct sdb_device *sdbfs_scan(struct sdbfs *fs, int newscan);
+void sdbfs_index_invalidate(struct sdbfs *fs, unsigned long offset, int count);
 
 /* Defined in access.c */
 int sdbfs_fstat(struct sdbfs *fs, struct sdb_device *record_return);
@@ -9,11 +9,12 @@
  */
 
 /* 	Command: calibration
-		Arguments: [force]
+		Arguments: [force | scan fast|linear | cache [erase]]
 
 		Description: launches RX timestamper calibration. */
 
 #include <string.h>
+#include <errno.h>
 #include <wrc.h>
 #include "shell.h"
 #include "eeprom.h"
@@ -24,7 +25,33 @@ static int cmd_calibration(const char *args[])
 {
 	uint32_t trans;
 
-	if (args[0] && !strcasecmp(args[0], "force")) {
+	if (args[0] && !strcasecmp(args[0], "scan")) {
+		struct rxts_cal_stats *st = &rxts_cal_stats;
+
+		if (args[1] && !strcasecmp(args[1], "linear"))
+			rxts_cal_linear = 1;
+		else if (args[1] && !strcasecmp(args[1], "fast"))
+			rxts_cal_linear = 0;
+		else if (args[1])
+			return -EINVAL;
+		mprintf("t24p scan: %s\n", rxts_cal_linear ? "linear" : "fast");
+		if (st->scan_ms)
+			mprintf("last calibration: %s scan, %d ms, "
+				"%d ms after link up\n",
+				st->linear ? "linear" : "fast",
+				st->scan_ms, st->link_ms);
+		return 0;
+#ifdef CONFIG_CALIB_CACHE
+	} else if (args[0] && !strcasecmp(args[0], "cache")) {
+		int i;
+
+		if (args[1] && !strcasecmp(args[1], "erase"))
+			for (i = 0; i < CAL_CACHE_SLOTS; i++)
+				calib_cache_drop(i);
+		calib_cache_show();
+		return 0;
+#endif
+	} else if (args[0] && !strcasecmp(args[0], "force")) {
 		if (measure_t24p(&trans) < 0)
 			return -1;
 		return eeprom_phtrans(WRPC_FMC_I2C, FMC_EEPROM_ADR, &trans, 1);
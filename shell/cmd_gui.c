@@ -4,9 +4,11 @@
 		Description: launches the WR Core monitor GUI */
 
 #include "shell.h"
+#include "util.h"
 
 static int cmd_gui(const char *args[])
 {
+	scr_invalidate(); /* the first refresh draws everything */
 	wrc_ui_mode = UI_GUI_MODE;
 	return 0;
 }
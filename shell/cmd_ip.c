@@ -15,19 +15,6 @@
 #include "shell.h"
 #include "../lib/ipv4.h"
 
-static void decode_ip(const char *str, unsigned char *ip)
-{
-	int i, x;
-
-	/* Don't try to detect bad input; need small code */
-	for (i = 0; i < 4; ++i) {
-		str = fromdec(str, &x);
-		ip[i] = x;
-		if (*str == '.')
-			++str;
-	}
-}
-
 static int cmd_ip(const char *args[])
 {
 	unsigned char ip[4];
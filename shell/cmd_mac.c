@@ -17,19 +17,6 @@
 #include "endpoint.h"
 #include "../lib/ipv4.h"
 
-static void decode_mac(const char *str, unsigned char *mac)
-{
-	int i, x;
-
-	/* Don't try to detect bad input; need small code */
-	for (i = 0; i < 6; ++i) {
-		str = fromhex(str, &x);
-		mac[i] = x;
-		if (*str == ':')
-			++str;
-	}
-}
-
 static int cmd_mac(const char *args[])
 {
 	unsigned char mac[6];
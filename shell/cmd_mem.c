@@ -0,0 +1,30 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <wrc.h>
+#include "shell.h"
+
+/* From the linker script */
+extern char _fdata[], _fbss[], _ebss[], _endram[], _fstack[];
+
+static int cmd_mem(const char *args[])
+{
+	int stack = _fstack + 4 - _endram;
+	int unused = stack_unused();
+
+	pp_printf("text+rodata %6d\n", (int)_fdata);
+	pp_printf("data        %6d\n", _fbss - _fdata);
+	pp_printf("bss         %6d\n", _ebss - _fbss);
+	pp_printf("free        %6d\n", _endram - _ebss);
+	pp_printf("stack       %6d (max used %d, never used %d)\n",
+		  stack, stack - unused, unused);
+	pp_printf("total       %6d\n", CONFIG_RAMSIZE);
+	return 0;
+}
+
+DEFINE_WRC_COMMAND(mem) = {
+	.name = "mem",
+	.exec = cmd_mem,
+};
@@ -0,0 +1,28 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <string.h>
+#include <errno.h>
+#include <wrc.h>
+
+#include "shell.h"
+#include "nvstate.h"
+
+static int cmd_nvstate(const char *args[])
+{
+	if (args[0] && !strcasecmp(args[0], "erase")) {
+		if (nvstate_erase() < 0)
+			return -EIO;
+	} else if (args[0]) {
+		return -EINVAL;
+	}
+	nvstate_show();
+	return 0;
+}
+
+DEFINE_WRC_COMMAND(nvstate) = {
+	.name = "nvstate",
+	.exec = cmd_nvstate,
+};
@@ -7,26 +7,32 @@
  * Released according to the GNU GPL, version 2 or any later version.
  */
 /*  Command: refresh
-    Arguments: seconds: Time interval to update gui/stat statistics (>= 0)
+    Arguments: seconds: Time interval to update gui/stat statistics (>= 0),
+               or milliseconds if followed by "ms"
 
     Description: Configures time interval to update gui/stat statistics by monitor. */
 
+#include <string.h>
 #include <wrc.h>
 #include "shell.h"
 
 static int cmd_refresh(const char *args[])
 {
+	const char *s;
 	int sec;
 
 	if (args[0] && !args[1]) {
-		fromdec(args[0], &sec);
+		s = fromdec(args[0], &sec);
 	}
 	else {
-		pp_printf("Usage: refresh <seconds>\n");
+		pp_printf("Usage: refresh <seconds> | <milliseconds>ms\n");
 		return 0;
 	}
 
-	wrc_ui_refperiod = sec*TICS_PER_SECOND;
+	if (!strcasecmp(s, "ms"))
+		wrc_ui_refperiod = sec * TICS_PER_SECOND / 1000;
+	else
+		wrc_ui_refperiod = sec*TICS_PER_SECOND;
 	pp_printf("\n");
 	return 0;
 }
@@ -32,8 +32,8 @@
 
 static int cmd_sfp(const char *args[])
 {
-	int8_t sfpcount = 1, i, temp;
-	struct s_sfpinfo sfp;
+	int8_t sfpcount, i, temp;
+	struct s_sfpinfo sfp, *dbsfp;
 	static char pn[SFP_PN_LEN + 1] = "\0";
 
 	if (args[0] && !strcasecmp(args[0], "detect")) {
@@ -51,8 +51,7 @@ static int cmd_sfp(const char *args[])
 //    return 0;
 //  }
 	else if (!strcasecmp(args[0], "erase")) {
-		if (eeprom_sfpdb_erase(WRPC_FMC_I2C, FMC_EEPROM_ADR) ==
-		    EE_RET_I2CERR)
+		if (sfp_db_erase() == EE_RET_I2CERR)
 			mprintf("Could not erase DB\n");
 	} else if (args[4] && !strcasecmp(args[0], "add")) {
 		if (strlen(args[1]) > 16)
@@ -66,32 +65,31 @@ static int cmd_sfp(const char *args[])
 		sfp.dTx = atoi(args[2]);
 		sfp.dRx = atoi(args[3]);
 		sfp.alpha = atoi(args[4]);
-		temp = eeprom_get_sfp(WRPC_FMC_I2C, FMC_EEPROM_ADR, &sfp, 1, 0);
+		temp = sfp_db_add(&sfp);
 		if (temp == EE_RET_DBFULL)
 			mprintf("SFP DB is full\n");
-		else if (temp == EE_RET_I2CERR)
+		else if (temp < 0)
 			mprintf("I2C error\n");
 		else
 			mprintf("%d SFPs in DB\n", temp);
 	} else if (args[0] && !strcasecmp(args[0], "show")) {
+		sfpcount = sfp_db_count();
+		if (sfpcount == 0) {
+			mprintf("SFP database empty...\n");
+			return 0;
+		}
 		for (i = 0; i < sfpcount; ++i) {
-			temp = eeprom_get_sfp(WRPC_FMC_I2C, FMC_EEPROM_ADR,
-					      &sfp, 0, i);
-			if (!i) {
-				sfpcount = temp;	//only in first round valid sfpcount is returned from eeprom_get_sfp
-				if (sfpcount == 0 || sfpcount == 0xFF) {
-					mprintf("SFP database empty...\n");
-					return 0;
-				} else if (sfpcount == -1) {
-					mprintf("SFP database corrupted...\n");
-					return 0;
-				}
+			dbsfp = sfp_db_get(i);
+			mprintf("%d: ", i + 1);
+			if (!dbsfp) {
+				mprintf("corrupted\n");
+				continue;
 			}
-			mprintf("%d: PN:", i + 1);
+			mprintf("PN:");
 			for (temp = 0; temp < 16; ++temp)
-				mprintf("%c", sfp.pn[temp]);
-			mprintf(" dTx: %d, dRx: %d, alpha: %d\n", sfp.dTx,
-				sfp.dRx, sfp.alpha);
+				mprintf("%c", dbsfp->pn[temp]);
+			mprintf(" dTx: %d, dRx: %d, alpha: %d\n", dbsfp->dTx,
+				dbsfp->dRx, dbsfp->alpha);
 		}
 	} else if (args[0] && !strcasecmp(args[0], "match")) {
 		if (pn[0] == '\0') {
@@ -99,7 +97,7 @@ static int cmd_sfp(const char *args[])
 			return 0;
 		}
 		strncpy(sfp.pn, pn, SFP_PN_LEN);
-		if (eeprom_match_sfp(WRPC_FMC_I2C, FMC_EEPROM_ADR, &sfp) > 0) {
+		if (sfp_db_match(&sfp) > 0) {
 			mprintf("SFP matched, dTx=%d, dRx=%d, alpha=%d\n",
 				sfp.dTx, sfp.dRx, sfp.alpha);
 			sfp_deltaTx = sfp.dTx;
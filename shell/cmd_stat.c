@@ -2,13 +2,18 @@
 #include "endpoint.h"
 #include <string.h>
 #include <wrc.h>
+#include "stat-bin.h"
 
 static int cmd_stat(const char *args[])
 {
-	if (!strcasecmp(args[0], "bts"))
+	if (args[0] && !strcasecmp(args[0], "bts")) {
 		mprintf("%d ps\n", ep_get_bitslide());
-	else
-		wrc_ui_mode = UI_STAT_MODE;
+		return 0;
+	}
+#ifdef CONFIG_STAT_BIN
+	wrc_stat_bin = args[0] && !strcasecmp(args[0], "bin");
+#endif
+	wrc_ui_mode = UI_STAT_MODE;
 
 	return 0;
 }
@@ -0,0 +1,53 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <string.h>
+#include <errno.h>
+#include <wrc.h>
+#include <task.h>
+
+#include "shell.h"
+
+static void task_list(void)
+{
+	struct task_idle_stats *s = &task_idle_stats;
+	struct wrc_task *t;
+	uint32_t total;
+	int n;
+
+	/* period is in ms, the times in tics */
+	pp_printf("task         period     runs overruns max-time    total\n");
+	for (t = __task_begin; t < __task_end; t++) {
+		n = pp_printf("%s", t->name);
+		while (n++ < 12)
+			pp_printf(" ");
+		pp_printf("%6d %8u %8u %8u %8u\n", t->period, t->nrun,
+			  t->noverrun, t->max_tics, t->total_tics);
+	}
+
+	total = timer_get_tics() - s->start;
+	if (total > 0xffffffff / 100)
+		n = s->idle / (total / 100);
+	else
+		n = total ? s->idle * 100 / total : 0;
+	pp_printf("idle: %d%% in the last second, %d%% of %u tics\n",
+		  s->last_pct, n, total);
+}
+
+static int cmd_task(const char *args[])
+{
+	if (!args[0])
+		task_list();
+	else if (!strcasecmp(args[0], "clear"))
+		task_clear_stats();
+	else
+		return -EINVAL;
+	return 0;
+}
+
+DEFINE_WRC_COMMAND(task) = {
+	.name = "task",
+	.exec = cmd_task,
+};
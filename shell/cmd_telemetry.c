@@ -0,0 +1,54 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <wrc.h>
+
+#include "shell.h"
+#include "telemetry.h"
+#include "../lib/ipv4.h"
+
+static int cmd_telemetry(const char *args[])
+{
+	struct telemetry_cfg *c = &telemetry_cfg;
+
+	if (!args[0]) {
+		/* just report */
+	} else if (!strcasecmp(args[0], "off")) {
+		c->enabled = 0;
+	} else if (!strcasecmp(args[0], "dest") && args[1]) {
+		decode_ip(args[1], c->ip);
+		if (args[2])
+			fromdec(args[2], &c->port);
+		c->enabled = 1;
+	} else if (!strcasecmp(args[0], "mac") && args[1]) {
+		decode_mac(args[1], c->mac);
+	} else if (!strcasecmp(args[0], "period") && args[1]) {
+		fromdec(args[1], &c->period);
+	} else {
+		return -EINVAL;
+	}
+
+	if (!c->enabled) {
+		mprintf("telemetry: off\n");
+		return 0;
+	}
+	mprintf("telemetry: %d.%d.%d.%d:%d ", c->ip[0], c->ip[1], c->ip[2],
+		c->ip[3], c->port);
+	mprintf("(%02x:%02x:%02x:%02x:%02x:%02x) ", c->mac[0], c->mac[1],
+		c->mac[2], c->mac[3], c->mac[4], c->mac[5]);
+	if (c->period)
+		mprintf("every %d ms\n", c->period);
+	else
+		mprintf("every servo update\n");
+	return 0;
+}
+
+DEFINE_WRC_COMMAND(telemetry) = {
+	.name = "telemetry",
+	.exec = cmd_telemetry,
+};
@@ -0,0 +1,37 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <wrc.h>
+
+#include "shell.h"
+#include "tempcomp.h"
+
+static int cmd_tempcomp(const char *args[])
+{
+	if (!args[0]) {
+		/* just report */
+	} else if (!strcasecmp(args[0], "on")) {
+		tempcomp.enabled = 1;
+	} else if (!strcasecmp(args[0], "off")) {
+		tempcomp.enabled = 0;
+		tempcomp.dtx = tempcomp.drx = 0;
+	} else if (!strcasecmp(args[0], "reset")) {
+		tempcomp_reset();
+	} else if (!strcasecmp(args[0], "ref") && args[1]) {
+		tempcomp.ref = atoi(args[1]) << 8;
+	} else {
+		return -EINVAL;
+	}
+	tempcomp_show();
+	return 0;
+}
+
+DEFINE_WRC_COMMAND(tempcomp) = {
+	.name = "tempcomp",
+	.exec = cmd_tempcomp,
+};
@@ -0,0 +1,28 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#include <string.h>
+#include <errno.h>
+#include <wrc.h>
+
+#include "shell.h"
+
+static int cmd_trace(const char *args[])
+{
+	if (!args[0] || !strcasecmp(args[0], "dump"))
+		trace_dump(0);
+	else if (!strcasecmp(args[0], "raw"))
+		trace_dump(1);
+	else if (!strcasecmp(args[0], "clear"))
+		trace_clear();
+	else
+		return -EINVAL;
+	return 0;
+}
+
+DEFINE_WRC_COMMAND(trace) = {
+	.name = "trace",
+	.exec = cmd_trace,
+};
@@ -18,11 +18,14 @@
 #include "uart.h"
 #include "syscon.h"
 #include "shell.h"
+#include "console.h"
 #include "eeprom.h"
 
 #define SH_MAX_LINE_LEN 80
 #define SH_MAX_ARGS 8
 #define SH_ENVIRON_SIZE 256
+#define SH_HASH_SIZE 64 /* a power of two, at least twice the commands */
+#define SH_INIT_SIZE 256 /* the init script read in one go at boot */
 
 /* interactive shell state definitions */
 
@@ -44,6 +47,10 @@ static int cmd_pos = 0, cmd_len = 0;
 static int state = SH_PROMPT;
 static int current_key = 0;
 
+/* Command index + 1 (0 if free), built at boot by shell_init() */
+static uint8_t cmd_hash[SH_HASH_SIZE];
+static int cmd_hashed; /* -1 if there are too many commands */
+
 static int insert(char c)
 {
 	if (cmd_len >= SH_MAX_LINE_LEN)
@@ -71,6 +78,107 @@ static void esc(char code)
 	mprintf("\033[1%c", code);
 }
 
+static void insert_echo(char c)
+{
+	if (insert(c)) {
+		esc('@');
+		mprintf("%c", c);
+	}
+}
+
+static unsigned cmd_hashval(const char *s)
+{
+	unsigned h = 5381, c;
+
+	while ((c = *s++)) {
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		h = (h << 5) + h + c;
+	}
+	return h;
+}
+
+static void shell_build_index(void)
+{
+	struct wrc_shell_cmd *p;
+	unsigned h;
+
+	if (__cmd_end - __cmd_begin > SH_HASH_SIZE / 2) {
+		cmd_hashed = -1;
+		return;
+	}
+	for (p = __cmd_begin; p < __cmd_end; p++) {
+		for (h = cmd_hashval(p->name); cmd_hash[h % SH_HASH_SIZE]; h++)
+			;
+		cmd_hash[h % SH_HASH_SIZE] = p - __cmd_begin + 1;
+	}
+	cmd_hashed = 1;
+}
+
+static struct wrc_shell_cmd *shell_find(const char *name)
+{
+	struct wrc_shell_cmd *p;
+	unsigned h;
+	int i;
+
+	if (cmd_hashed > 0) {
+		for (h = cmd_hashval(name); (i = cmd_hash[h % SH_HASH_SIZE]); h++)
+			if (!strcasecmp(__cmd_begin[i - 1].name, name))
+				return __cmd_begin + i - 1;
+		return NULL;
+	}
+	for (p = __cmd_begin; p < __cmd_end; p++)
+		if (!strcasecmp(p->name, name))
+			return p;
+	return NULL;
+}
+
+/* Complete the command name (the first word) that ends at the cursor */
+static void complete(void)
+{
+	struct wrc_shell_cmd *p, *match = NULL;
+	int i, n = 0, len = 0;
+
+	for (i = 0; i < cmd_pos; i++)
+		if (cmd_buf[i] == ' ')
+			return;
+	if (cmd_pos < cmd_len && cmd_buf[cmd_pos] != ' ')
+		return;
+
+	for (p = __cmd_begin; p < __cmd_end; p++) {
+		if (strncasecmp(p->name, cmd_buf, cmd_pos))
+			continue;
+		if (!n++) {
+			match = p;
+			len = strlen(p->name);
+			continue;
+		}
+		/* what all the matches have in common */
+		for (i = cmd_pos; i < len && p->name[i] == match->name[i]; i++)
+			;
+		len = i;
+	}
+	if (!n)
+		return;
+
+	if (n > 1 && len == cmd_pos) {
+		/* Nothing to add: list the candidates and redraw the line */
+		mprintf("\n");
+		for (p = __cmd_begin; p < __cmd_end; p++)
+			if (!strncasecmp(p->name, cmd_buf, cmd_pos))
+				mprintf("%s  ", p->name);
+		cmd_buf[cmd_len] = 0;
+		mprintf("\nwrc# %s", cmd_buf);
+		for (i = cmd_len; i > cmd_pos; i--)
+			esc('D');
+		return;
+	}
+	for (i = cmd_pos; i < len; i++)
+		insert_echo(match->name[i]);
+	if (n == 1 && cmd_pos == cmd_len)
+		insert_echo(' ');
+}
+
 static int _shell_exec()
 {
 	char *tokptr[SH_MAX_ARGS + 1];
@@ -103,17 +211,22 @@ static int _shell_exec()
 	if (*tokptr[0] == '#')
 		return 0;
 
-	for (p = __cmd_begin; p < __cmd_end; p++)
-		if (!strcasecmp(p->name, tokptr[0])) {
-			rv = p->exec((const char **)(tokptr + 1));
-			if (rv < 0)
-				mprintf("Command \"%s\": error %d\n",
-					p->name, rv);
-			return rv;
-		}
-
-	mprintf("Unrecognized command \"%s\".\n", tokptr[0]);
-	return -EINVAL;
+	p = shell_find(tokptr[0]);
+	if (!p) {
+		mprintf("Unrecognized command \"%s\".\n", tokptr[0]);
+		return -EINVAL;
+	}
+#ifdef CONFIG_CONSOLE_BUF
+	/* the user asked for this output: wait for room */
+	console_set_blocking(1);
+	rv = p->exec((const char **)(tokptr + 1));
+	console_set_blocking(0);
+#else
+	rv = p->exec((const char **)(tokptr + 1));
+#endif
+	if (rv < 0)
+		mprintf("Command \"%s\": error %d\n", p->name, rv);
+	return rv;
 }
 
 int shell_exec(const char *cmd)
@@ -125,6 +238,8 @@ int shell_exec(const char *cmd)
 
 void shell_init()
 {
+	if (!cmd_hashed)
+		shell_build_index();
 	cmd_len = cmd_pos = 0;
 	state = SH_PROMPT;
 }
@@ -189,14 +304,12 @@ void shell_interactive()
 				break;
 
 			case '\t':
+				complete();
 				break;
 
 			default:
-				if (!(current_key & ESCAPE_FLAG)
-				    && insert(current_key)) {
-					esc('@');
-					mprintf("%c", current_key);
-				}
+				if (!(current_key & ESCAPE_FLAG))
+					insert_echo(current_key);
 				break;
 
 			}
@@ -248,18 +361,44 @@ const char *fromdec(const char *dec, int *v)
 	return dec;
 }
 
-int shell_boot_script(void)
+void decode_ip(const char *str, unsigned char *ip)
 {
-	uint8_t next = 0;
+	int i, x;
+
+	/* Don't try to detect bad input; need small code */
+	for (i = 0; i < 4; ++i) {
+		str = fromdec(str, &x);
+		ip[i] = x;
+		if (*str == '.')
+			++str;
+	}
+}
 
-	if (!has_eeprom)
-		return -1;
+void decode_mac(const char *str, unsigned char *mac)
+{
+	int i, x;
+
+	/* Don't try to detect bad input; need small code */
+	for (i = 0; i < 6; ++i) {
+		str = fromhex(str, &x);
+		mac[i] = x;
+		if (*str == ':')
+			++str;
+	}
+}
+
+/* The old way, for scripts larger than SH_INIT_SIZE: one read per line */
+static int shell_boot_lines(void)
+{
+	uint8_t next = 0;
 
 	while (1) {
 		cmd_len = eeprom_init_readcmd(WRPC_FMC_I2C, FMC_EEPROM_ADR,
 					      (uint8_t *)cmd_buf,
 					      SH_MAX_LINE_LEN, next);
-		if (cmd_len <= 0) {
+		if (cmd_len < 0)
+			return cmd_len;
+		if (cmd_len == 0) {
 			if (next == 0)
 				mprintf("Empty init script...\n");
 			break;
@@ -273,3 +412,39 @@ int shell_boot_script(void)
 
 	return 0;
 }
+
+int shell_boot_script(void)
+{
+	static uint8_t script[SH_INIT_SIZE]; /* not on the stack */
+	int len, i, n;
+
+	if (!has_eeprom)
+		return -1;
+
+	/* Read it all at once, then run it line by line */
+	len = eeprom_init_read(WRPC_FMC_I2C, FMC_EEPROM_ADR, script,
+			       sizeof(script));
+	if (len > (int)sizeof(script))
+		return shell_boot_lines();
+	if (len <= 0) {
+		mprintf("Empty init script...\n");
+		return 0;
+	}
+
+	for (i = 0; i < len; i += n + 1) {
+		for (n = 0; i + n < len && script[i + n] != '\n'; n++)
+			;
+		if (!n)
+			continue;
+		if (n > SH_MAX_LINE_LEN)
+			return EE_RET_CORRPT; /* like eeprom_init_readcmd() */
+		cmd_len = n;
+		memcpy(cmd_buf, script + i, cmd_len);
+		cmd_buf[cmd_len] = 0;
+
+		mprintf("executing: %s\n", cmd_buf);
+		_shell_exec();
+	}
+
+	return 0;
+}
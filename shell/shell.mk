@@ -14,9 +14,16 @@ obj-$(CONFIG_WR_NODE) += \
 	shell/cmd_init.o \
 	shell/cmd_ptrack.o \
 	shell/cmd_help.o \
-	shell/cmd_refresh.o
+	shell/cmd_refresh.o \
+	shell/cmd_task.o \
+	shell/cmd_mem.o
 
 obj-$(CONFIG_ETHERBONE) +=			shell/cmd_ip.o
 obj-$(CONFIG_PPSI) +=				shell/cmd_verbose.o
 obj-$(CONFIG_CMD_CONFIG) +=			shell/cmd_config.o
 obj-$(CONFIG_CMD_SLEEP) +=			shell/cmd_sleep.o
+obj-$(CONFIG_TELEMETRY) +=			shell/cmd_telemetry.o
+obj-$(CONFIG_TEMPCOMP) +=			shell/cmd_tempcomp.o
+obj-$(CONFIG_SYSLOG) +=				shell/cmd_syslog.o
+obj-$(CONFIG_NVSTATE) +=			shell/cmd_nvstate.o
+obj-$(CONFIG_TRACE_BIN) +=			shell/cmd_trace.o
@@ -11,6 +11,8 @@
 #include "softpll_ng.h"
 
 #include "irq.h"
+#include "task.h"
+#include "fixdiv.h"
 
 volatile int irq_count = 0;
 
@@ -78,6 +80,20 @@ struct softpll_state {
 static volatile struct softpll_state softpll;
 
 static volatile int ptracker_mask = 0;
+
+/* What changed since spll_get_dirty(), see softpll_ng.h */
+static volatile uint32_t spll_dirty = SPLL_DIRTY_ALL;
+static int last_locked, last_delocks;
+static int32_t last_shift;
+
+/* From the main loop: the interrupt sets bits in spll_dirty too */
+static void spll_mark_dirty(uint32_t bits)
+{
+	unsigned int ie = irq_save();
+
+	spll_dirty |= bits;
+	irq_restore(ie);
+}
 /* fixme: should be done by spll_init() but spll_init is called to
  * switch modes (and we won't like messing around with ptrackers
  * there) */
@@ -95,7 +111,24 @@ static inline void update_ptrackers(struct softpll_state *s, int tag_value, int
 	if(tag_source > spll_n_chan_ref)
 		return;
 		
-	ptrackers_update(s->ptrackers, tag_value, tag_source);
+	if (ptrackers_update(s->ptrackers, tag_value, tag_source))
+		spll_dirty |= 1 << tag_source;
+}
+
+/* Once per interrupt, not per tag: look for lock and shifter changes */
+static inline void update_dirty(struct softpll_state *s)
+{
+	int locked = (s->seq_state == SEQ_READY);
+
+	if (locked != last_locked || s->delock_count != last_delocks) {
+		spll_dirty |= SPLL_DIRTY_LOCK;
+		last_locked = locked;
+		last_delocks = s->delock_count;
+	}
+	if (s->mpll.phase_shift_current != last_shift) {
+		spll_dirty |= SPLL_DIRTY_SHIFT;
+		last_shift = s->mpll.phase_shift_current;
+	}
 }
 
 static inline void sequencing_fsm(struct softpll_state *s, int tag_value, int tag_source)
@@ -278,8 +311,13 @@ void _irq_entry()
 		sequencing_fsm(s, tag_value, tag_source);
 		update_loops(s, tag_value, tag_source);
 	}
+	update_dirty(s);
 
 	irq_count++;
+#ifdef CONFIG_WR_NODE
+	if (task_waiting)
+		task_sample_events(); /* the main loop is in task_idle() */
+#endif
 	clear_irq();
 }
 
@@ -304,6 +342,7 @@ void spll_init(int mode, int slave_ref_channel, int align_pps)
 
 	s->mode = mode;
 	s->delock_count = 0;
+	spll_dirty = SPLL_DIRTY_ALL;
 
 	SPLL->DAC_HPLL = 0;
 	SPLL->DAC_MAIN = 0;
@@ -323,7 +362,7 @@ void spll_init(int mode, int slave_ref_channel, int align_pps)
 		if(SPLL->ECCR & SPLL_ECCR_EXT_SUPPORTED)
 			external_init(&s->ext, spll_n_chan_ref + spll_n_chan_out, align_pps);
 		else {
-			TRACE_DEV("softpll: attempting to enable GM mode on non-GM hardware.\n");
+			TRACE_LOG(TRACE_ERR, "softpll: attempting to enable GM mode on non-GM hardware.\n");
 			return;
 		}
 	}
@@ -383,7 +422,8 @@ void spll_start_channel(int channel)
 	struct softpll_state *s = (struct softpll_state *) &softpll;
 
 	if (s->seq_state != SEQ_READY || !channel) {
-		TRACE_DEV("Can't start channel %d, the PLL is not ready\n",
+		TRACE_LOG(TRACE_WARNING,
+			  "Can't start channel %d, the PLL is not ready\n",
 			  channel);
 		return;
 	}
@@ -409,28 +449,13 @@ int spll_check_lock(int channel)
 		    && softpll.aux[channel - 1].pll.dmtd.ld.locked;
 }
 
-#ifdef CONFIG_PPSI /* use __div64_32 from ppsi library to save libgcc memory */
-static int32_t from_picos(int32_t ps)
-{
-	extern uint32_t __div64_32(uint64_t *n, uint32_t base);
-	uint64_t ups = ps;
-
-	if (ps >= 0) {
-		ups *= 1 << HPLL_N;
-		__div64_32(&ups, CLOCK_PERIOD_PICOSECONDS);
-		return ups;
-	}
-	ups = -ps * (1 << HPLL_N);
-	__div64_32(&ups, CLOCK_PERIOD_PICOSECONDS);
-	return -ups;
-}
-#else /* previous implementation: ptp-noposix has no __div64_32 available */
+/* No 64-bit divide here: see fixdiv.h; valid for |ps| < 2^31 */
 static int32_t from_picos(int32_t ps)
 {
-	return (int32_t) ((int64_t) ps * (int64_t) (1 << HPLL_N) /
-			  (int64_t) CLOCK_PERIOD_PICOSECONDS);
+	if (ps >= 0)
+		return FIXMULDIV(ps, 1 << HPLL_N, CLOCK_PERIOD_PICOSECONDS);
+	return -FIXMULDIV(-ps, 1 << HPLL_N, CLOCK_PERIOD_PICOSECONDS);
 }
-#endif
 
 static int32_t to_picos(int32_t units)
 {
@@ -446,6 +471,7 @@ static void set_phase_shift(int channel, int32_t value_picoseconds)
 	int div = (DIVIDE_DMTD_CLOCKS_BY_2 ? 2 : 1);
 	mpll_set_phase_shift(st, from_picos(value_picoseconds) / div);
 	softpll.mpll_shift_ps = value_picoseconds;
+	spll_mark_dirty(SPLL_DIRTY_SHIFT); /* now busy */
 }
 
 void spll_set_phase_shift(int channel, int32_t value_picoseconds)
@@ -536,6 +562,17 @@ void spll_enable_ptracker(int ref_channel, int enable)
 			spll_enable_tagger(ref_channel, 0);
 		TRACE_DEV("Disabling ptracker tagger: %d\n", ref_channel);
 	}
+	spll_mark_dirty(1 << ref_channel);
+}
+
+uint32_t spll_get_dirty(void)
+{
+	unsigned int ie = irq_save();
+	uint32_t dirty = spll_dirty;
+
+	spll_dirty = 0;
+	irq_restore(ie);
+	return dirty;
 }
 
 int spll_get_delock_count()
@@ -585,7 +622,7 @@ int spll_update_aux_clocks()
 
 			case AUX_LOCK_PLL:
 				if (s->pll.dmtd.ld.locked) {
-					TRACE_DEV ("softpll: channel %d locked [aligning @ %d ps]\n", ch, softpll.mpll_shift_ps);
+					TRACE_LOG(TRACE_INFO, "softpll: channel %d locked [aligning @ %d ps]\n", ch, softpll.mpll_shift_ps);
 					set_phase_shift(ch, softpll.mpll_shift_ps);
 					s->seq_state = AUX_ALIGN_PHASE;
 				}
@@ -602,7 +639,7 @@ int spll_update_aux_clocks()
 
 			case AUX_READY:
 				if (!softpll.mpll.ld.locked || !s->pll.dmtd.ld.locked) {
-					TRACE_DEV("softpll: aux channel %d or mpll lost lock\n", ch);
+					TRACE_LOG(TRACE_WARNING, "softpll: aux channel %d or mpll lost lock\n", ch);
 					aux_set_channel_status(ch, 0); 
 					s->seq_state = AUX_DISABLED;
 				}
@@ -101,6 +101,14 @@ void spll_enable_ptracker(int ref_channel, int enable);
 /* Reads tracked phase shift value for given reference channel */
 int spll_read_ptracker(int ref_channel, int32_t *phase_ps, int *enabled);
 
+/* Returns what changed since the previous call, and clears it. Bit n is set when
+   the ptracker of reference channel n has a new average (or was enabled/disabled),
+   so callers only need to read the channels that changed. */
+#define SPLL_DIRTY_SHIFT 0x40000000	/* phase shift of channel 0 moved or stopped */
+#define SPLL_DIRTY_LOCK 0x80000000	/* lock state or delock count changed */
+#define SPLL_DIRTY_ALL 0xffffffff	/* after spll_init(): read everything */
+uint32_t spll_get_dirty(void);
+
 /* Calls aux clock handling state machine. Must be called regularly (although it is not time-critical)
    in the main loop of the program if aux clocks are used in the design. */
 int spll_update_aux_clocks();
@@ -78,6 +78,7 @@ int ptrackers_update(struct spll_ptracker_state *ptrackers, int tag,
 			s->ready = 1;
 			s->acc = 0;
 			s->avg_count = 0;
+			return 1; /* a new average */
 		}
 	}
 
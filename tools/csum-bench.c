@@ -0,0 +1,130 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * Host benchmark of the IP checksum in lib/ipv4-csum.c, against the
+ * short-at-a-time loop it replaced, for the frame sizes we see (IP
+ * header, small and full-size ICMP echo) and for odd start addresses.
+ * Results are checked against the old loop first.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "../lib/ipv4.h"
+
+#define LOOPS 200000
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define cycles() __rdtsc()
+#else
+#define cycles() 0ULL
+#endif
+
+static uint8_t frame[1600] __attribute__((aligned(4)));
+static volatile unsigned int result;
+
+/* The previous ipv4_checksum(): one short at a time */
+static unsigned int old_checksum(unsigned short *buf, int shorts)
+{
+	int i;
+	unsigned int sum;
+
+	sum = 0;
+	for (i = 0; i < shorts; ++i)
+		sum += buf[i];
+
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += (sum >> 16);
+
+	return (~sum & 0xffff);
+}
+
+/* Byte by byte, in the host order of shorts: for any start address */
+static uint16_t ref_checksum(const uint8_t *p, int len)
+{
+	uint32_t sum = 0;
+	union {
+		uint16_t s;
+		uint8_t b[2];
+	} u;
+	int i;
+
+	for (i = 0; i < len; i += 2) {
+		u.b[0] = p[i];
+		u.b[1] = i + 1 < len ? p[i + 1] : 0;
+		sum += u.s;
+	}
+	return ipv4_csum_fold(sum);
+}
+
+static int check(void)
+{
+	int i, ofs, len, errors = 0;
+
+	for (i = 0; i < 1000000; i++) {
+		ofs = rand() & 3;
+		len = rand() % (sizeof(frame) - 4);
+		if (ipv4_csum_fold(ipv4_csum_partial(frame + ofs, len, 0))
+		    != ref_checksum(frame + ofs, len)) {
+			if (errors++ < 10)
+				printf("mismatch: offset %d, len %d\n",
+				       ofs, len);
+		}
+	}
+	return errors;
+}
+
+static void run(const char *name, int ofs, int len)
+{
+	struct timespec t0, t1;
+	unsigned long long c0, c1;
+	double ns[2], cyc[2];
+	int i, k;
+
+	for (k = 0; k < 2; k++) {
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		c0 = cycles();
+		for (i = 0; i < LOOPS; i++)
+			if (k)
+				result = ipv4_csum_fold(
+					ipv4_csum_partial(frame + ofs, len, 0));
+			else
+				result = old_checksum(
+					(unsigned short *)(frame + ofs),
+					len / 2);
+		c1 = cycles();
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ns[k] = ((t1.tv_sec - t0.tv_sec) * 1e9
+			 + t1.tv_nsec - t0.tv_nsec) / LOOPS;
+		cyc[k] = (double)(c1 - c0) / LOOPS;
+	}
+	printf("  %-14s %5d %7.1f ns %7.1f cycles %7.1f ns %7.1f cycles\n",
+	       name, len, ns[0], cyc[0], ns[1], cyc[1]);
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	for (i = 0; i < sizeof(frame); i++)
+		frame[i] = rand();
+	if (check()) {
+		printf("checksum errors\n");
+		return 1;
+	}
+
+	printf("  %-14s %5s %-26s %-26s\n", "", "bytes", "old (shorts)",
+	       "ipv4_csum_partial");
+	run("ip header", 0, 20);
+	run("echo, 64", 0, 64);
+	run("echo, 1472", 0, 1472);
+	run("odd start", 1, 1472);
+	run("short-aligned", 2, 1472);
+	return 0;
+}
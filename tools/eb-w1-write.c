@@ -23,12 +23,14 @@
 #include <etherbone.h>
 
 #include <w1.h>
+#include "page-diff.h"
 
 #define W1_VENDOR	0xce42		/* CERN */
 #define W1_DEVICE	0x779c5443	/* WR-Periph-1Wire */
 
 char *prgname;
 int verbose;
+int force; /* write all pages, even if unchanged */
 
 eb_address_t BASE_ONEWIRE;
 eb_device_t device;
@@ -38,8 +40,8 @@ extern struct w1_bus wrpc_w1_bus;
 static int write_w1(int w1base, int w1len)
 {
 	struct w1_dev *d;
-	uint8_t buf[w1len];
-	int i;
+	uint8_t buf[w1len], cur[w1len];
+	int i, pos, run, total = 0;
 
 	w1_scan_bus(&wrpc_w1_bus);
 
@@ -65,12 +67,42 @@ static int write_w1(int w1base, int w1len)
 			i, w1len);
 		return 1;
 	}
-	i = w1_write_eeprom_bus(&wrpc_w1_bus, w1base, buf, w1len);
-	if (i != w1len) {
-		fprintf(stderr, "Tried to write %i bytes, retval %i\n",
-			w1len, i);
+
+	/* Only write the pages that change: it takes 10ms each */
+	if (force) {
+		for (i = 0; i < w1len; i++)
+			cur[i] = ~buf[i];
+	} else {
+		i = w1_read_eeprom_bus(&wrpc_w1_bus, w1base, cur, w1len);
+		if (i != w1len) {
+			fprintf(stderr, "Reading %i bytes, retval %i\n",
+				w1len, i);
+			return 1;
+		}
+	}
+	for (pos = 0; (run = page_diff_next(cur, buf, w1len, w1base, 32,
+					    &pos)); pos += run) {
+		if (verbose)
+			fprintf(stderr, "writing offset %i, len %i\n",
+				w1base + pos, run);
+		i = w1_write_eeprom_bus(&wrpc_w1_bus, w1base + pos, buf + pos,
+					run);
+		if (i != run) {
+			fprintf(stderr, "Tried to write %i bytes, retval %i\n",
+				run, i);
+			return 1;
+		}
+		total += run;
+	}
+
+	/* Check the whole thing, it is cheap compared to writing */
+	i = w1_read_eeprom_bus(&wrpc_w1_bus, w1base, cur, w1len);
+	if (i != w1len || memcmp(cur, buf, w1len)) {
+		fprintf(stderr, "%s: verify failed\n", prgname);
 		return 1;
 	}
+	if (verbose)
+		fprintf(stderr, "Wrote %i of %i bytes\n", total, w1len);
 	return 0;
 }
 
@@ -81,7 +113,7 @@ static int write_w1(int w1base, int w1len)
 
 static int help(void)
 {
-	fprintf(stderr, "%s: Use: \"%s [-v] [-i <index>] <device> <addr> <len>\n",
+	fprintf(stderr, "%s: Use: \"%s [-v] [-f] [-i <index>] <device> <addr> <len>\n",
 		prgname, prgname);
 	return 1;
 }
@@ -103,7 +135,7 @@ int main(int argc, char **argv)
 	prgname = argv[0];
 	i = -1;
 
-	while ((c = getopt(argc, argv, "i:v")) != -1) {
+	while ((c = getopt(argc, argv, "fi:v")) != -1) {
 		switch(c) {
 		case 'i':
 			i = strtol(optarg, &tail, 0);
@@ -112,6 +144,9 @@ int main(int argc, char **argv)
 				exit(1);
 			}
 			break;
+		case 'f':
+			force++;
+			break;
 		case 'v':
 			verbose++;
 			break;
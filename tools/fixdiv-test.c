@@ -0,0 +1,73 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * Exhaustive host check of include/fixdiv.h: for the divisors and
+ * ratios used in the firmware (both boards), compare FIXDIV and
+ * FIXMULDIV with exact division over the whole input range. Build
+ * with optimization, so the constants fold ("make check" does it).
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/fixdiv.h"
+
+static int errors;
+
+static void report(const char *what, uint32_t u, uint32_t got, uint32_t exp)
+{
+	if (errors++ < 10)
+		fprintf(stderr, "%s: u = %u: got %u, expected %u\n",
+			what, u, got, exp);
+}
+
+/* Every u < 2^31 */
+#define CHECK_DIV(d) do {						\
+	uint32_t u;							\
+	for (u = 0; u < (1U << 31); u++)				\
+		if (FIXDIV(u, d) != u / (d))				\
+			report("FIXDIV(u, " #d ")", u,			\
+			       FIXDIV(u, d), u / (d));			\
+	printf("FIXDIV(u, %s): checked\n", #d);				\
+} while (0)
+
+/* Every u < 2^31 whose result fits 32 bits */
+#define CHECK_MULDIV(a, b) do {						\
+	uint64_t max = ((1ULL << 32) * (b) - 1) / (a);			\
+	uint32_t u;							\
+	if (max >= (1U << 31))						\
+		max = (1U << 31) - 1;					\
+	for (u = 0; u <= max; u++)					\
+		if (FIXMULDIV(u, a, b) != (uint64_t)u * (a) / (b))	\
+			report("FIXMULDIV(u, " #a ", " #b ")", u,	\
+			       FIXMULDIV(u, a, b),			\
+			       (uint64_t)u * (a) / (b));		\
+	printf("FIXMULDIV(u, %s, %s): checked %llu values\n", #a, #b,	\
+	       (unsigned long long)max + 1);				\
+} while (0)
+
+int main(void)
+{
+	CHECK_DIV(3);
+	CHECK_DIV(10);
+	CHECK_DIV(125);
+	CHECK_DIV(1000);
+	CHECK_DIV(0x7fffffff);
+
+	/* from_picos() and pps_gen, for both REF_CLOCK_PERIOD_PS */
+	CHECK_MULDIV(1 << 14, 8000);
+	CHECK_MULDIV(1 << 14, 16000);
+	CHECK_MULDIV(1000, 8000);
+	CHECK_MULDIV(1000, 16000);
+	CHECK_MULDIV(8000, 1000);
+	CHECK_MULDIV(16000, 1000);
+
+	if (errors) {
+		printf("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
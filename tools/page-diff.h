@@ -0,0 +1,42 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+#ifndef __PAGE_DIFF_H__
+#define __PAGE_DIFF_H__
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Find the next run of pages where "old" and "new" differ, starting at
+ * *offset. Both buffers are "len" bytes long and are placed at "base"
+ * in the device, so pages are aligned to the device and not to the
+ * buffers. Returns the length of the run, or 0 if there are no more
+ * differences, and sets *offset to its start (relative to the buffers).
+ */
+static inline int page_diff_next(const uint8_t *old, const uint8_t *new,
+				 int len, int base, int psize, int *offset)
+{
+	int pos = *offset, start = -1, end;
+
+	while (pos < len) {
+		end = ((base + pos) / psize + 1) * psize - base;
+		if (end > len)
+			end = len;
+		if (memcmp(old + pos, new + pos, end - pos)) {
+			if (start < 0)
+				start = pos;
+		} else if (start >= 0) {
+			break;
+		}
+		pos = end;
+	}
+	if (start < 0)
+		return 0;
+	*offset = start;
+	return pos - start;
+}
+
+#endif /* __PAGE_DIFF_H__ */
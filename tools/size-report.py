@@ -0,0 +1,89 @@
+#!/usr/bin/python
+
+#####################################################
+## This work is part of the White Rabbit project
+##
+## Break down the RAM used by each object file, from the map of
+## a "ld -r --gc-sections" link (see "make size-report"), so only
+## what is really linked in is counted.
+##
+## Use: size-report.py <map> [<ramsize> <stacksize>]
+#####################################################
+
+import re
+import sys
+
+KINDS = ['text', 'rodata', 'data', 'bss']
+
+one_line = re.compile(r'^ (\S+)\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S.*)$')
+name_only = re.compile(r'^ (\S+)$')
+addr_line = re.compile(r'^\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S.*)$')
+
+def kind(section):
+	if section.startswith('.text') or section == '.boot':
+		return 'text'
+	if section.startswith('.rodata'):
+		return 'rodata'
+	if section.startswith(('.data', '.sdata', '.cmd', '.task')):
+		return 'data'
+	if section.startswith(('.bss', '.sbss')) or section == 'COMMON':
+		return 'bss'
+	return None # debug information and the like
+
+def parse(filename):
+	objs = {}
+	started = False
+	name = None
+	for line in open(filename):
+		line = line.rstrip('\n')
+		if not started:
+			started = line.startswith('Linker script and memory map')
+			continue
+		m = one_line.match(line)
+		if m:
+			section, size, obj = m.groups()
+		elif name:
+			m = addr_line.match(line)
+			name, section = None, name
+			if not m:
+				continue
+			size, obj = m.groups()
+		else:
+			m = name_only.match(line)
+			if m:
+				name = m.group(1)
+			continue
+		k = kind(section)
+		if not k:
+			continue
+		sizes = objs.setdefault(obj, dict.fromkeys(KINDS, 0))
+		sizes[k] += int(size, 16)
+	return objs
+
+def main():
+	if len(sys.argv) not in (2, 4):
+		sys.stderr.write('%s: use "%s <map> [<ramsize> <stacksize>]"\n'
+				 % (sys.argv[0], sys.argv[0]))
+		sys.exit(1)
+	objs = parse(sys.argv[1])
+	total = dict.fromkeys(KINDS, 0)
+
+	print('%8s %8s %8s %8s %8s  %s' % tuple(KINDS + ['total', 'object']))
+	order = sorted(objs, key=lambda o: -sum(objs[o].values()))
+	for obj in order:
+		s = objs[obj]
+		for k in KINDS:
+			total[k] += s[k]
+		print('%8d %8d %8d %8d %8d  %s' %
+		      tuple([s[k] for k in KINDS] + [sum(s.values()), obj]))
+	used = sum(total.values())
+	print('%8d %8d %8d %8d %8d  (total)' %
+	      tuple([total[k] for k in KINDS] + [used]))
+
+	if len(sys.argv) == 4:
+		ram, stack = int(sys.argv[2]), int(sys.argv[3])
+		print('\nRAM %d: %d program, %d stack, %d free' %
+		      (ram, used, stack, ram - stack - used))
+
+if __name__ == '__main__':
+	main()
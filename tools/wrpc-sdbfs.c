@@ -0,0 +1,432 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * Build, check and compare sdbfs images for the wrpc storage, without
+ * the fpga-config-space tools:
+ *
+ *    wrpc-sdbfs build <dir> <image>
+ *    wrpc-sdbfs verify <image>
+ *    wrpc-sdbfs diff [-p <pagesize>] <old-image> <new-image>
+ *
+ * "build" follows the same layout as gensdbfs: the directory comes
+ * first, then the files in the order of --SDB-CONFIG-- (and then the
+ * other ones, sorted), each at a 64-byte boundary. Only "position",
+ * "write" and "maxsize" are understood in the configuration file.
+ *
+ * "diff" prints the write list that turns the old image (e.g. what
+ * wrpc-w1-read returned) into the new one, as "<offset> <len>" lines
+ * covering whole device pages.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <ctype.h>
+#include <endian.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+
+#include <sdb.h>
+#include "page-diff.h"
+
+#define SDBFS_VENDOR	0x46696c6544617461LL	/* "FileData" */
+#define SDBFS_ALIGN	64
+#define SDBFS_MAXFILES	32
+#define SDBFS_MAXSIZE	(64 * 1024)
+#define CONFIG_NAME	"--SDB-CONFIG--"
+
+struct sdbfs_file {
+	char name[20];
+	int write, maxsize;
+	int size;		/* of the contents */
+	int offset;		/* allocated position */
+	uint8_t *data;
+};
+
+static struct sdbfs_file files[SDBFS_MAXFILES];
+static int nfiles, position;
+
+char *prgname;
+int verbose;
+
+static struct sdbfs_file *file_get(const char *name)
+{
+	struct sdbfs_file *f;
+	int i;
+
+	for (i = 0, f = files; i < nfiles; i++, f++)
+		if (!strcmp(f->name, name))
+			return f;
+	if (nfiles == SDBFS_MAXFILES) {
+		fprintf(stderr, "%s: too many files\n", prgname);
+		exit(1);
+	}
+	if (strlen(name) > 19) {
+		fprintf(stderr, "%s: name too long: \"%s\"\n", prgname, name);
+		exit(1);
+	}
+	f = files + nfiles++;
+	strcpy(f->name, name);
+	f->maxsize = -1;
+	return f;
+}
+
+/* Lines are "name", or "  key = value" for the name above */
+static int read_config(const char *dir)
+{
+	char path[PATH_MAX], line[256], key[64];
+	struct sdbfs_file *f = NULL;
+	int lineno = 0, value, isdot = 0;
+	FILE *cfg;
+
+	sprintf(path, "%s/%s", dir, CONFIG_NAME);
+	cfg = fopen(path, "r");
+	if (!cfg && errno == ENOENT)
+		return 0;
+	if (!cfg) {
+		fprintf(stderr, "%s: %s: %s\n", prgname, path,
+			strerror(errno));
+		return -1;
+	}
+	while (fgets(line, sizeof(line), cfg)) {
+		lineno++;
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '#' || line[strspn(line, " \t")] == '\0')
+			continue;
+		if (!isspace(line[0])) {
+			isdot = !strcmp(line, ".");
+			f = isdot ? NULL : file_get(line);
+			continue;
+		}
+		if (sscanf(line, " %63[a-z] = %i", key, &value) != 2) {
+			fprintf(stderr, "%s: %s:%i: syntax error\n", prgname,
+				path, lineno);
+			goto err;
+		}
+		if (isdot && !strcmp(key, "position"))
+			position = value;
+		else if (f && !strcmp(key, "write"))
+			f->write = value;
+		else if (f && !strcmp(key, "maxsize"))
+			f->maxsize = value;
+		else
+			fprintf(stderr, "%s: %s:%i: \"%s\" ignored\n", prgname,
+				path, lineno, key);
+	}
+	fclose(cfg);
+	return 0;
+err:
+	fclose(cfg);
+	return -1;
+}
+
+static int name_sort(const struct dirent **a, const struct dirent **b)
+{
+	return strcmp((*a)->d_name, (*b)->d_name);
+}
+
+static int read_files(const char *dir)
+{
+	char path[PATH_MAX];
+	struct dirent **namelist;
+	struct sdbfs_file *f;
+	struct stat st;
+	FILE *in;
+	int i, n;
+
+	n = scandir(dir, &namelist, NULL, name_sort);
+	if (n < 0) {
+		fprintf(stderr, "%s: %s: %s\n", prgname, dir,
+			strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		if (namelist[i]->d_name[0] == '.'
+		    || !strcmp(namelist[i]->d_name, CONFIG_NAME))
+			continue;
+		sprintf(path, "%s/%s", dir, namelist[i]->d_name);
+		if (stat(path, &st) < 0 || !S_ISREG(st.st_mode))
+			continue;
+		f = file_get(namelist[i]->d_name); /* configured ones first */
+		f->size = st.st_size;
+		if (f->maxsize < 0)
+			f->maxsize = f->size;
+		if (f->size > f->maxsize) {
+			fprintf(stderr, "%s: %s: %i bytes, maxsize is %i\n",
+				prgname, path, f->size, f->maxsize);
+			return -1;
+		}
+		f->data = malloc(f->size + 1);
+		in = fopen(path, "r");
+		if (!in || fread(f->data, 1, f->size, in) != f->size) {
+			fprintf(stderr, "%s: %s: read error\n", prgname, path);
+			return -1;
+		}
+		fclose(in);
+	}
+	for (i = 0; i < nfiles; i++) {
+		if (!files[i].data) {
+			fprintf(stderr, "%s: %s: configured but missing\n",
+				prgname, files[i].name);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void fill_product(struct sdb_product *p, const char *name, int type)
+{
+	char id[4] = "    ";
+	int len = strlen(name);
+
+	memcpy(id, name, len < 4 ? len : 4);
+	p->vendor_id = htobe64(SDBFS_VENDOR);
+	memcpy(&p->device_id, id, 4); /* big endian: the name reads right */
+	p->version = htonl(1);
+	memset(p->name, ' ', sizeof(p->name));
+	memcpy(p->name, name, len);
+	p->record_type = type;
+}
+
+static int do_build(const char *dir, const char *image)
+{
+	struct sdb_interconnect *ic;
+	struct sdb_device *d;
+	struct sdbfs_file *f;
+	uint8_t *buf;
+	int i, next, len, end;
+	FILE *out;
+
+	if (read_config(dir) < 0 || read_files(dir) < 0)
+		return 1;
+
+	/* Allocate, and find the length of the data we must store */
+	next = position + (nfiles + 1) * sizeof(struct sdb_device);
+	len = next;
+	for (i = 0, f = files; i < nfiles; i++, f++) {
+		if (!f->maxsize) {
+			fprintf(stderr, "%s: %s: empty, with no maxsize\n",
+				prgname, f->name);
+			return 1;
+		}
+		next = (next + SDBFS_ALIGN - 1) / SDBFS_ALIGN * SDBFS_ALIGN;
+		f->offset = next;
+		next += f->maxsize;
+		if (f->size && f->offset + f->size > len)
+			len = f->offset + f->size;
+	}
+	end = next;
+	if (end > SDBFS_MAXSIZE) {
+		fprintf(stderr, "%s: image too big (%i bytes)\n", prgname, end);
+		return 1;
+	}
+
+	buf = calloc(1, len);
+	ic = (void *)(buf + position);
+	ic->sdb_magic = htonl(SDB_MAGIC);
+	ic->sdb_records = htons(nfiles + 1);
+	ic->sdb_version = 1;
+	ic->sdb_bus_type = sdb_data;
+	ic->sdb_component.addr_first = htobe64(position);
+	ic->sdb_component.addr_last = htobe64(end - 1);
+	fill_product(&ic->sdb_component.product, ".", sdb_type_interconnect);
+
+	for (i = 0, f = files; i < nfiles; i++, f++) {
+		d = (void *)(ic + 1 + i);
+		d->bus_specific = htonl(SDB_DATA_READ
+					| (f->write ? SDB_DATA_WRITE : 0));
+		d->sdb_component.addr_first = htobe64(f->offset);
+		d->sdb_component.addr_last = htobe64(f->offset + f->maxsize
+						     - 1);
+		fill_product(&d->sdb_component.product, f->name,
+			     sdb_type_device);
+		memcpy(buf + f->offset, f->data, f->size);
+		if (verbose)
+			fprintf(stderr, "%-19s @ %5i-%5i (%i used)\n", f->name,
+				f->offset, f->offset + f->maxsize - 1, f->size);
+	}
+
+	out = fopen(image, "w");
+	if (!out || fwrite(buf, 1, len, out) != len || fclose(out)) {
+		fprintf(stderr, "%s: %s: %s\n", prgname, image,
+			strerror(errno));
+		return 1;
+	}
+	if (verbose)
+		fprintf(stderr, "%s: %i bytes (%i allocated)\n", image, len,
+			end);
+	return 0;
+}
+
+static uint8_t *read_image(const char *name, int *len)
+{
+	uint8_t *buf = malloc(SDBFS_MAXSIZE);
+	FILE *in = fopen(name, "r");
+
+	if (!in) {
+		fprintf(stderr, "%s: %s: %s\n", prgname, name,
+			strerror(errno));
+		exit(1);
+	}
+	*len = fread(buf, 1, SDBFS_MAXSIZE, in);
+	fclose(in);
+	return buf;
+}
+
+/* Same entry points as the lm32 code looks at */
+static int find_magic(uint8_t *buf, int len)
+{
+	static int entry_points[] = {0, 64, 128, 256, 512, 1024};
+	int i;
+
+	for (i = 0; i < sizeof(entry_points) / sizeof(entry_points[0]); i++) {
+		if (entry_points[i] + 4 > len)
+			break;
+		if (ntohl(*(uint32_t *)(buf + entry_points[i])) == SDB_MAGIC)
+			return entry_points[i];
+	}
+	return -1;
+}
+
+static int do_verify(const char *image)
+{
+	struct sdb_interconnect *ic;
+	struct sdb_device *d, *d2;
+	uint64_t first, last, f2, l2, dirlast;
+	uint8_t *buf;
+	int i, j, len, entry, n, errors = 0;
+
+	buf = read_image(image, &len);
+	entry = find_magic(buf, len);
+	if (entry < 0) {
+		fprintf(stderr, "%s: %s: no sdbfs magic\n", prgname, image);
+		return 1;
+	}
+	ic = (void *)(buf + entry);
+	n = ntohs(ic->sdb_records);
+	if (n < 1 || entry + n * sizeof(*d) > len) {
+		fprintf(stderr, "%s: %s: %i records don't fit the image\n",
+			prgname, image, n);
+		return 1;
+	}
+	if (ic->sdb_component.product.record_type != sdb_type_interconnect) {
+		fprintf(stderr, "%s: first record is not an interconnect\n",
+			prgname);
+		errors++;
+	}
+	first = be64toh(ic->sdb_component.addr_first);
+	last = be64toh(ic->sdb_component.addr_last);
+	dirlast = entry + n * sizeof(*d) - 1;
+	printf("%016llx:%08x @ %08llx-%08llx %.19s\n",
+	       (long long)be64toh(ic->sdb_component.product.vendor_id),
+	       ntohl(ic->sdb_component.product.device_id),
+	       (long long)first, (long long)last,
+	       ic->sdb_component.product.name);
+
+	for (i = 1; i < n; i++) {
+		d = (void *)(ic + i);
+		f2 = be64toh(d->sdb_component.addr_first);
+		l2 = be64toh(d->sdb_component.addr_last);
+		printf("%016llx:%08x @ %08llx-%08llx %.19s%s\n",
+		       (long long)be64toh(d->sdb_component.product.vendor_id),
+		       ntohl(d->sdb_component.product.device_id),
+		       (long long)f2, (long long)l2,
+		       d->sdb_component.product.name,
+		       ntohl(d->bus_specific) & SDB_DATA_WRITE ? "" : " (ro)");
+		if (d->sdb_component.product.record_type != sdb_type_device) {
+			fprintf(stderr, "record %i: type 0x%02x\n", i,
+				d->sdb_component.product.record_type);
+			errors++;
+			continue;
+		}
+		if (f2 > l2 || f2 < first || l2 > last) {
+			fprintf(stderr, "record %i: bad range\n", i);
+			errors++;
+		}
+		if (f2 <= dirlast && l2 >= entry) {
+			fprintf(stderr, "record %i: overlaps the directory\n", i);
+			errors++;
+		}
+		for (j = 1; j < i; j++) {
+			d2 = (void *)(ic + j);
+			if (f2 <= be64toh(d2->sdb_component.addr_last)
+			    && l2 >= be64toh(d2->sdb_component.addr_first)) {
+				fprintf(stderr, "record %i: overlaps record %i\n",
+					i, j);
+				errors++;
+			}
+		}
+	}
+	if (errors)
+		fprintf(stderr, "%s: %s: %i errors\n", prgname, image, errors);
+	return errors ? 1 : 0;
+}
+
+static int do_diff(int psize, const char *oldname, const char *newname)
+{
+	uint8_t *old, *new;
+	int i, oldlen, newlen, pos, run, total = 0;
+
+	old = read_image(oldname, &oldlen);
+	new = read_image(newname, &newlen);
+	/* what the old image doesn't have must be written */
+	for (i = oldlen; i < newlen; i++)
+		old[i] = ~new[i];
+
+	for (pos = 0; (run = page_diff_next(old, new, newlen, 0, psize,
+					    &pos)); pos += run) {
+		printf("%i %i\n", pos, run);
+		total += run;
+	}
+	if (verbose)
+		fprintf(stderr, "%i of %i bytes to write\n", total, newlen);
+	return 0;
+}
+
+static int help(void)
+{
+	fprintf(stderr, "%s: Use: \"%s [-v] build <dir> <image>\"\n"
+		"    \"%s [-v] verify <image>\"\n"
+		"    \"%s [-v] [-p <pagesize>] diff <old-image> <new-image>\"\n",
+		prgname, prgname, prgname, prgname);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int c, psize = 32;
+
+	prgname = argv[0];
+	while ((c = getopt(argc, argv, "p:v")) != -1) {
+		switch(c) {
+		case 'p':
+			psize = atoi(optarg);
+			if (psize < 1)
+				exit(help());
+			break;
+		case 'v':
+			verbose++;
+			break;
+		default:
+			exit(help());
+		}
+	}
+	argv += optind;
+	argc -= optind;
+
+	if (argc == 3 && !strcmp(argv[0], "build"))
+		return do_build(argv[1], argv[2]);
+	if (argc == 2 && !strcmp(argv[0], "verify"))
+		return do_verify(argv[1]);
+	if (argc == 3 && !strcmp(argv[0], "diff"))
+		return do_diff(psize, argv[1], argv[2]);
+	return help();
+}
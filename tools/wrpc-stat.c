@@ -0,0 +1,144 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * Decode the records printed by "stat bin" (see include/stat-bin.h)
+ * and print them as the lines of the text "stat" command, so the
+ * output can be fed to wr_graph.py. Other lines are copied unchanged;
+ * bad records and gaps in the sequence are reported on stderr.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#include <arpa/inet.h> /* ntohl etc */
+
+#include "../include/stat-bin.h"
+#include "../include/crc16.h"
+
+static char *prgname;
+
+static int64_t be64(int64_t x)
+{
+	uint32_t *p = (void *)&x;
+
+	return (int64_t)((uint64_t)ntohl(p[0]) << 32 | ntohl(p[1]));
+}
+
+static int b64val(int c)
+{
+	const char *b64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz0123456789+/";
+	const char *p;
+
+	if (c == '=')
+		return 0;
+	p = strchr(b64, c);
+	return c && p ? p - b64 : -1;
+}
+
+/* Decode exactly STAT_BIN_LEN characters into the record */
+static int decode(const char *s, struct stat_rec *r)
+{
+	uint8_t buf[STAT_BIN_LEN / 4 * 3];
+	int i, j, v[4];
+
+	for (i = 0; i < STAT_BIN_LEN; i += 4) {
+		for (j = 0; j < 4; j++)
+			if ((v[j] = b64val(s[i + j])) < 0)
+				return -1;
+		buf[i / 4 * 3 + 0] = v[0] << 2 | v[1] >> 4;
+		buf[i / 4 * 3 + 1] = v[1] << 4 | v[2] >> 2;
+		buf[i / 4 * 3 + 2] = v[2] << 6 | v[3];
+	}
+	memcpy(r, buf, sizeof(*r));
+	if (ntohs(r->magic) != STAT_BIN_MAGIC
+	    || r->version != STAT_BIN_VERSION)
+		return -1;
+	if (ntohs(r->crc) != crc16(0xffff, r, offsetof(struct stat_rec, crc)))
+		return -1;
+	return 0;
+}
+
+/* The same format as wrc_log_stats() */
+static void print_rec(struct stat_rec *r)
+{
+	int32_t temp = ntohl(r->temp);
+	int64_t mu = be64(r->mu);
+
+	printf("lnk:%d rx:%u tx:%u ", !!(r->flags & STAT_F_LINK_UP),
+	       ntohl(r->rx), ntohl(r->tx));
+	printf("lock:%d ", !!(r->flags & STAT_F_PLL_LOCKED));
+	printf("sv:%d ", !!(r->flags & STAT_F_SERVO_VALID));
+	printf("ss:'%.*s' ", (int)sizeof(r->servo_state), r->servo_state);
+	printf("aux:%x ", ntohl(r->aux));
+	printf("sec:%u nsec:%u ", ntohl(r->sec), ntohl(r->nsec));
+	printf("mu:%lli ", (long long)mu);
+	printf("dms:%lli ", (long long)be64(r->delay_ms));
+	printf("dtxm:%i drxm:%i ", (int32_t)ntohl(r->delta_tx_m),
+	       (int32_t)ntohl(r->delta_rx_m));
+	printf("dtxs:%i drxs:%i ", (int32_t)ntohl(r->delta_tx_s),
+	       (int32_t)ntohl(r->delta_rx_s));
+	printf("asym:%i ", (int32_t)ntohl(r->asymmetry));
+	printf("crtt:%lli ", (long long)(mu
+		- (int32_t)ntohl(r->delta_tx_m) - (int32_t)ntohl(r->delta_rx_m)
+		- (int32_t)ntohl(r->delta_tx_s) - (int32_t)ntohl(r->delta_rx_s)));
+	printf("cko:%i ", (int32_t)ntohl(r->cur_offset));
+	printf("setp:%i ", (int32_t)ntohl(r->cur_setpoint));
+	printf("hd:%i md:%i ad:%i ", (int32_t)ntohl(r->dac_hpll),
+	       (int32_t)ntohl(r->dac_main), (int32_t)ntohl(r->dac_aux));
+	printf("ucnt:%u ", ntohl(r->update_count));
+	printf("temp: %.4f C\n", temp / 65536.0);
+}
+
+int main(int argc, char **argv)
+{
+	struct stat_rec r;
+	FILE *f = stdin;
+	char line[1024], *s;
+	uint32_t seq, next = 0;
+	int started = 0, nline = 0;
+
+	prgname = argv[0];
+	if (argc > 2) {
+		fprintf(stderr, "%s: use \"%s [<logfile>]\"\n",
+			prgname, prgname);
+		exit(1);
+	}
+	if (argc == 2) {
+		f = fopen(argv[1], "r");
+		if (!f) {
+			fprintf(stderr, "%s: %s: %s\n", prgname, argv[1],
+				strerror(errno));
+			exit(1);
+		}
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		nline++;
+		/* The start may follow other output on the same line */
+		s = strchr(line, STAT_BIN_START);
+		if (!s) {
+			fputs(line, stdout);
+			continue;
+		}
+		if (strlen(s + 1) < STAT_BIN_LEN || decode(s + 1, &r) < 0) {
+			fprintf(stderr, "%s: line %i: bad record\n", prgname,
+				nline);
+			continue;
+		}
+		seq = ntohl(r.seq);
+		if (started && seq != next)
+			fprintf(stderr, "%s: line %i: %u records lost\n",
+				prgname, nline, seq - next);
+		started = 1;
+		next = seq + 1;
+		print_rec(&r);
+	}
+	return 0;
+}
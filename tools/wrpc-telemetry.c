@@ -0,0 +1,108 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * Receive the telemetry records sent by wrpc-sw (the "telemetry" shell
+ * command) and print one line per record, in the "key:value" style of
+ * the "stat" command, so the output can be parsed like the UART log.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h> /* ntohl etc */
+#include <netinet/in.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "../include/telemetry.h"
+
+static char *prgname;
+
+static int64_t be64(int64_t x)
+{
+	uint32_t *p = (void *)&x;
+
+	return (int64_t)((uint64_t)ntohl(p[0]) << 32 | ntohl(p[1]));
+}
+
+static void print_rec(struct sockaddr_in *from, struct telemetry_rec *r)
+{
+	int32_t temp = ntohl(r->temp);
+
+	printf("%s seq:%u ", inet_ntoa(from->sin_addr), ntohl(r->seq));
+	printf("sv:%d lock:%d ", !!(r->flags & TELEMETRY_F_SERVO_VALID),
+	       !!(r->flags & TELEMETRY_F_PLL_LOCKED));
+	printf("sec:%u nsec:%u ", ntohl(r->sec), ntohl(r->nsec));
+	printf("mu:%lli dms:%lli ", (long long)be64(r->mu),
+	       (long long)be64(r->delay_ms));
+	printf("cko:%i setp:%i skew:%i ucnt:%u ", (int32_t)ntohl(r->cur_offset),
+	       (int32_t)ntohl(r->cur_setpoint), (int32_t)ntohl(r->cur_skew),
+	       ntohl(r->update_count));
+	printf("hd:%i md:%i ad:%i ", (int32_t)ntohl(r->dac_hpll),
+	       (int32_t)ntohl(r->dac_main), (int32_t)ntohl(r->dac_aux));
+	if (r->flags & TELEMETRY_F_PTRACK_EN)
+		printf("phase:%i ", (int32_t)ntohl(r->ptrack_phase));
+	printf("temp:%.4f\n", temp / 65536.0);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_in addr, from;
+	socklen_t fromlen;
+	struct telemetry_rec *r;
+	unsigned char buf[1500];
+	int sock, port = TELEMETRY_PORT, len;
+
+	prgname = argv[0];
+	if (argc > 2 || (argc == 2 && sscanf(argv[1], "%i", &port) != 1)) {
+		fprintf(stderr, "%s: use \"%s [<udp-port>]\"\n",
+			prgname, prgname);
+		exit(1);
+	}
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0) {
+		fprintf(stderr, "%s: socket(): %s\n", prgname,
+			strerror(errno));
+		exit(1);
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "%s: bind(%i): %s\n", prgname, port,
+			strerror(errno));
+		exit(1);
+	}
+
+	r = (void *)buf;
+	while (1) {
+		fromlen = sizeof(from);
+		len = recvfrom(sock, buf, sizeof(buf), 0,
+			       (struct sockaddr *)&from, &fromlen);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "%s: recvfrom(): %s\n", prgname,
+				strerror(errno));
+			exit(1);
+		}
+		/* Newer versions only append fields: accept longer records */
+		if (len < sizeof(*r) || ntohs(r->magic) != TELEMETRY_MAGIC
+		    || r->version < TELEMETRY_VERSION) {
+			fprintf(stderr, "%s: %s: bad record (%i bytes)\n",
+				prgname, inet_ntoa(from.sin_addr), len);
+			continue;
+		}
+		print_rec(&from, r);
+	}
+	return 0;
+}
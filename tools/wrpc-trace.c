@@ -0,0 +1,179 @@
+/*
+ * This work is part of the White Rabbit project
+ *
+ * Released according to the GNU GPL, version 2 or any later version.
+ */
+
+/*
+ * Format the binary trace records printed by "trace raw" (see
+ * lib/trace.c): each line is the time, the address of the format, the
+ * number of arguments and the arguments, in hex. The format strings
+ * (and constant "%s" arguments) are read from the elf file that is
+ * running on the target.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <elf.h>
+#include <arpa/inet.h> /* ntohl etc */
+
+#define NARGS 6 /* TRACE_BIN_ARGS */
+
+static char *prgname;
+
+struct section {
+	uint32_t addr, size;
+	char *data;
+};
+static struct section *sections;
+static int nsections;
+
+static int load_elf(FILE *f)
+{
+	Elf32_Ehdr eh;
+	Elf32_Shdr sh;
+	struct section *s;
+	int i;
+
+	if (fread(&eh, sizeof(eh), 1, f) != 1)
+		return -1;
+	if (memcmp(eh.e_ident, ELFMAG, SELFMAG)
+	    || eh.e_ident[EI_CLASS] != ELFCLASS32
+	    || eh.e_ident[EI_DATA] != ELFDATA2MSB) {
+		errno = EINVAL;
+		return -1;
+	}
+	nsections = ntohs(eh.e_shnum);
+	sections = calloc(nsections, sizeof(*sections));
+	for (i = 0; i < nsections; i++) {
+		if (fseek(f, ntohl(eh.e_shoff) + i * ntohs(eh.e_shentsize),
+			  SEEK_SET) < 0 || fread(&sh, sizeof(sh), 1, f) != 1)
+			return -1;
+		if (ntohl(sh.sh_type) != SHT_PROGBITS
+		    || !(ntohl(sh.sh_flags) & SHF_ALLOC))
+			continue;
+		s = sections + i;
+		s->addr = ntohl(sh.sh_addr);
+		s->size = ntohl(sh.sh_size);
+		s->data = malloc(s->size + 1);
+		if (fseek(f, ntohl(sh.sh_offset), SEEK_SET) < 0
+		    || fread(s->data, 1, s->size, f) != s->size)
+			return -1;
+		s->data[s->size] = '\0'; /* so all strings are terminated */
+	}
+	return 0;
+}
+
+/* Return the string at a target address, or NULL */
+static char *elf_string(uint32_t addr)
+{
+	struct section *s;
+	int i;
+
+	for (i = 0, s = sections; i < nsections; i++, s++)
+		if (s->data && addr >= s->addr && addr < s->addr + s->size)
+			return s->data + addr - s->addr;
+	return NULL;
+}
+
+/* Print one record, using the host printf for each conversion */
+static void print_record(uint32_t tics, const char *fmt, int nargs,
+			 uint32_t *args)
+{
+	char spec[32];
+	const char *f, *str;
+	int i = 0, len;
+
+	printf("%u.%03u ", tics / 1000, tics % 1000);
+	while (*fmt) {
+		if (*fmt != '%' || fmt[1] == '%') {
+			putchar(*fmt);
+			fmt += *fmt == '%' ? 2 : 1;
+			continue;
+		}
+		f = fmt + 1;
+		f += strspn(f, "-+ #0123456789.");
+		f += strspn(f, "lhz"); /* the target has no 64-bit args */
+		if (!*f)
+			break;
+		len = f - fmt;
+		if (len > sizeof(spec) - 3)
+			len = sizeof(spec) - 3;
+		memcpy(spec, fmt, len);
+		/* Rebuild the conversion without the length modifiers */
+		while (len > 1 && strchr("lhz", spec[len - 1]))
+			len--;
+		spec[len] = *f;
+		spec[len + 1] = '\0';
+		fmt = f + 1;
+		if (i >= NARGS) {
+			printf("<?>");
+			i++;
+			continue;
+		}
+		switch (*f) {
+		case 's':
+			str = elf_string(args[i]);
+			printf(spec, str ? str : "(?)");
+			break;
+		case 'p':
+			printf("0x%x", args[i]);
+			break;
+		default:
+			printf(spec, args[i]);
+		}
+		i++;
+	}
+	if (nargs > NARGS)
+		printf("  (%d arguments lost)\n", nargs - NARGS);
+}
+
+int main(int argc, char **argv)
+{
+	FILE *f, *in = stdin;
+	char line[256];
+	uint32_t tics, addr, args[NARGS];
+	const char *fmt;
+	int nargs;
+
+	prgname = argv[0];
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "%s: Use \"%s <wrc.elf> [<trace-file>]\"\n"
+			"  the trace file (default stdin) is the output of "
+			"\"trace raw\"\n", prgname, prgname);
+		exit(1);
+	}
+	f = fopen(argv[1], "r");
+	if (!f || load_elf(f) < 0) {
+		fprintf(stderr, "%s: %s: %s\n", prgname, argv[1],
+			strerror(errno));
+		exit(1);
+	}
+	fclose(f);
+	if (argc == 3) {
+		in = fopen(argv[2], "r");
+		if (!in) {
+			fprintf(stderr, "%s: %s: %s\n", prgname, argv[2],
+				strerror(errno));
+			exit(1);
+		}
+	}
+
+	while (fgets(line, sizeof(line), in)) {
+		memset(args, 0, sizeof(args));
+		if (sscanf(line, "%x %x %d %x %x %x %x %x %x", &tics, &addr,
+			   &nargs, args + 0, args + 1, args + 2, args + 3,
+			   args + 4, args + 5) < 3)
+			continue; /* not a trace record: the prompt, maybe */
+		fmt = elf_string(addr);
+		if (!fmt) {
+			printf("%u.%03u <no format at 0x%x>\n", tics / 1000,
+			       tics % 1000, addr);
+			continue;
+		}
+		print_record(tics, fmt, nargs, args);
+	}
+	return 0;
+}
@@ -21,6 +21,7 @@
 #include <sys/mman.h>
 
 #include <w1.h>
+#include "page-diff.h"
 
 #define SPEC_W1_OFFSET 0x20600 /* from "sdb" on the shell, current gateware */
 
@@ -45,17 +46,18 @@ static struct spec_device devs[MAX_DEVICES];
 
 char *prgname;
 int verbose;
+int force; /* write all pages, even if unchanged */
 
 /* sames name as in ./dev because we reuse lm32 code */
 void *BASE_ONEWIRE;
-struct w1_bus wrpc_w1_bus;
+extern struct w1_bus wrpc_w1_bus;
 
 
 static int spec_write_w1(struct spec_device *spec, int w1base, int w1len)
 {
 	struct w1_dev *d;
-	uint8_t buf[w1len];
-	int i;
+	uint8_t buf[w1len], cur[w1len];
+	int i, pos, run, total = 0;
 
 	BASE_ONEWIRE = spec->mapaddr + SPEC_W1_OFFSET;
 	w1_scan_bus(&wrpc_w1_bus);
@@ -83,12 +85,42 @@ static int spec_write_w1(struct spec_device *spec, int w1base, int w1len)
 			i, w1len);
 		return 1;
 	}
-	i = w1_write_eeprom_bus(&wrpc_w1_bus, w1base, buf, w1len);
-	if (i != w1len) {
-		fprintf(stderr, "Tried to write %i bytes, retval %i\n",
-			w1len, i);
+
+	/* Only write the pages that change: it takes 10ms each */
+	if (force) {
+		for (i = 0; i < w1len; i++)
+			cur[i] = ~buf[i];
+	} else {
+		i = w1_read_eeprom_bus(&wrpc_w1_bus, w1base, cur, w1len);
+		if (i != w1len) {
+			fprintf(stderr, "Reading %i bytes, retval %i\n",
+				w1len, i);
+			return 1;
+		}
+	}
+	for (pos = 0; (run = page_diff_next(cur, buf, w1len, w1base, 32,
+					    &pos)); pos += run) {
+		if (verbose)
+			fprintf(stderr, "writing offset %i, len %i\n",
+				w1base + pos, run);
+		i = w1_write_eeprom_bus(&wrpc_w1_bus, w1base + pos, buf + pos,
+					run);
+		if (i != run) {
+			fprintf(stderr, "Tried to write %i bytes, retval %i\n",
+				run, i);
+			return 1;
+		}
+		total += run;
+	}
+
+	/* Check the whole thing, it is cheap compared to writing */
+	i = w1_read_eeprom_bus(&wrpc_w1_bus, w1base, cur, w1len);
+	if (i != w1len || memcmp(cur, buf, w1len)) {
+		fprintf(stderr, "%s: verify failed\n", prgname);
 		return 1;
 	}
+	if (verbose)
+		fprintf(stderr, "Wrote %i of %i bytes\n", total, w1len);
 	return 0;
 }
 
@@ -197,7 +229,7 @@ static int spec_scan_pci(struct spec_pci_id *id, struct spec_device *arr,
 
 static int help(void)
 {
-	fprintf(stderr, "%s: Use: \"%s [-v] [-b <bus>] <addr> <len>\n",
+	fprintf(stderr, "%s: Use: \"%s [-v] [-f] [-b <bus>] <addr> <len>\n",
 		prgname, prgname);
 	return 1;
 }
@@ -208,11 +240,14 @@ int main(int argc, char **argv)
 	struct spec_device *spec = NULL;
 	prgname = argv[0];
 
-	while ((c = getopt(argc, argv, "b:v")) != -1) {
+	while ((c = getopt(argc, argv, "b:fv")) != -1) {
 		switch(c) {
 		case 'b':
 			sscanf(optarg, "%i", &bus);
 			break;
+		case 'f':
+			force++;
+			break;
 		case 'v':
 			verbose++;
 			break;
@@ -28,6 +28,11 @@
 #include "shell.h"
 #include "lib/ipv4.h"
 #include "rxts_calibrator.h"
+#include "lib/syslog.h"
+#include "nvstate.h"
+#include "console.h"
+#include "sfp.h"
+#include "task.h"
 
 #include "wrc_ptp.h"
 
@@ -56,11 +61,20 @@ static void wrc_initialize()
 	wrpc_w1_init();
 	wrpc_w1_bus.detail = ONEWIRE_PORT;
 	w1_scan_bus(&wrpc_w1_bus);
+	w1_temp_init(&wrpc_w1_bus);
 
 	/*initialize I2C bus*/
+	mi2c_set_speed(CONFIG_I2C_KHZ);
 	mi2c_init(WRPC_FMC_I2C);
 	/*check if EEPROM is onboard*/
 	eeprom_present(WRPC_FMC_I2C, FMC_EEPROM_ADR);
+	sfp_db_load();
+#ifdef CONFIG_CALIB_CACHE
+	calib_cache_init();
+#endif
+#ifdef CONFIG_NVSTATE
+	nvstate_init();
+#endif
 
 	mac_addr[0] = 0x08;	//
 	mac_addr[1] = 0x00;	// CERN OUI
@@ -107,11 +121,11 @@ static int wrc_check_link()
 	int rv = 0;
 
 	if (!prev_link_state && link_state) {
-		TRACE_DEV("Link up.\n");
+		TRACE_LOG(TRACE_NOTICE, "Link up.\n");
 		gpio_out(GPIO_LED_LINK, 1);
 		rv = LINK_WENT_UP;
 	} else if (prev_link_state && !link_state) {
-		TRACE_DEV("Link down.\n");
+		TRACE_LOG(TRACE_NOTICE, "Link down.\n");
 		gpio_out(GPIO_LED_LINK, 0);
 		rv = LINK_WENT_DOWN;
 	} else
@@ -121,16 +135,97 @@ static int wrc_check_link()
 	return rv;
 }
 
+/* Follow the link state, for the TASK_LINK jobs */
+static void link_poll(void)
+{
+	int l_status = wrc_check_link();
+
+	switch (l_status) {
+	case LINK_WENT_UP:
+		rxts_link_up();
+#ifdef CONFIG_ETHERBONE
+		ipv4_link_up();
+#endif
+		break;
+
+	case LINK_WENT_DOWN:
+		if (wrc_ptp_get_mode() == WRC_MODE_SLAVE) {
+			spll_init(SPLL_MODE_FREE_RUNNING_MASTER, 0, 1);
+			shw_pps_gen_enable_output(0);
+		}
+		break;
+	}
+	wrc_link_up = (l_status == LINK_UP);
+}
+
+DEFINE_WRC_TASK(link, 0) = {
+	.name = "link",
+	.job = link_poll,
+	.period = 10,
+};
+
+static void ptp_poll(void)
+{
+	wrc_ptp_update();
+}
+
+DEFINE_WRC_TASK(ptp, 1) = {
+	.name = "ptp",
+	.job = ptp_poll,
+	.period = 1,
+	.events = EV_RX,
+};
+
+static void aux_clocks_poll(void)
+{
+	spll_update_aux_clocks();
+}
+
+DEFINE_WRC_TASK(aux_clocks, 2) = {
+	.name = "aux-clocks",
+	.job = aux_clocks_poll,
+	.period = 10,
+};
+
+#ifdef CONFIG_SYSLOG
+static int trace_syslog_severity(int subsys)
+{
+	switch (subsys & TRACE_SEV_MASK) {
+	case TRACE_ERR:
+		return SYSLOG_ERR;
+	case TRACE_WARNING:
+		return SYSLOG_WARNING;
+	case TRACE_NOTICE:
+		return SYSLOG_NOTICE;
+	case TRACE_INFO:
+		return SYSLOG_INFO;
+	}
+	/* Servo lines are what the UART shows by default */
+	return subsys & TRACE_SERVO ? SYSLOG_INFO : SYSLOG_DEBUG;
+}
+#endif
+
 void wrc_debug_printf(int subsys, const char *fmt, ...)
 {
 	va_list ap;
 
+#ifdef CONFIG_SYSLOG
+	/* When a collector is set, all of it goes there, not the UART */
+	if (syslog_cfg.enabled) {
+		va_start(ap, fmt);
+		syslog_vprintf(trace_syslog_severity(subsys), fmt, ap);
+		va_end(ap);
+		return;
+	}
+#endif
+
 	if (wrc_ui_mode)
 		return;
 
 	va_start(ap, fmt);
 
-	if (subsys & (1 << 5) /* was: TRACE_SERVO -- see commit message */)
+	if ((subsys & TRACE_SERVO)
+	    || (subsys & TRACE_SEV_MASK) >= TRACE_WARNING)
 		vprintf(fmt, ap);
 
 	va_end(ap);
@@ -158,18 +253,62 @@ static void ui_update()
 
 }
 
+DEFINE_WRC_TASK(ui, 8) = {
+	.name = "ui",
+	.job = ui_update,
+	.period = 10,
+	.events = EV_UART,
+};
+
 extern uint32_t _endram;
 extern uint32_t _fstack;
 #define ENDRAM_MAGIC 0xbadc0ffe
+#define STACK_PAINT 0x57ac57ac
+#define STACK_WARN 128 /* bytes */
+
+/* Fill the stack below us, so stack_unused() finds the high-water mark */
+static void __attribute__((noinline)) stack_paint(void)
+{
+	uint32_t *p, *sp = __builtin_frame_address(0);
+
+	for (p = &_endram + 1; p < sp - 16; p++)
+		*p = STACK_PAINT;
+}
+
+/* Bytes of stack that were never used since boot */
+int stack_unused(void)
+{
+	uint32_t *p = &_endram + 1;
+
+	while (p < &_fstack && *p == STACK_PAINT)
+		p++;
+	return (p - (&_endram + 1)) * 4;
+}
 
 static void check_stack(void)
 {
+	static int warned;
+
 	while (_endram != ENDRAM_MAGIC) {
 		mprintf("Stack overflow!\n");
+#ifdef CONFIG_CONSOLE_BUF
+		console_flush();
+#endif
 		timer_delay_ms(1000);
 	}
+	if (!warned && stack_unused() < STACK_WARN) {
+		mprintf("Warning: only %d bytes of stack were never used\n",
+			stack_unused());
+		warned = 1;
+	}
 }
 
+DEFINE_WRC_TASK(stack, 9) = {
+	.name = "stack",
+	.job = check_stack,
+	.period = 100,
+};
+
 #ifdef CONFIG_CHECK_RESET
 
 static void check_reset(void)
@@ -184,7 +323,7 @@ static void check_reset(void)
 
 	/* Before calling anything, find the beginning of the stack */
 	p = &_endram + 1;
-	while (!*p)
+	while (!*p || *p == STACK_PAINT)
 		p++;
 	p = (void *)((unsigned long)p & ~0xf); /* align */
 
@@ -209,6 +348,9 @@ static void check_reset(void)
 		save += 4;
 	}
 	pp_printf("Rebooting in 1 second\n\n\n");
+#ifdef CONFIG_CONSOLE_BUF
+	console_flush();
+#endif
 	timer_delay_ms(1000);
 
 	/* Zero the stack and start over (so we dump correctly next time) */
@@ -230,6 +372,7 @@ int main(void)
 	check_reset();
 	wrc_ui_mode = UI_SHELL_MODE;
 	_endram = ENDRAM_MAGIC;
+	stack_paint();
 
 	wrc_initialize();
 	usleep_init();
@@ -241,35 +384,6 @@ int main(void)
 	//try to read and execute init script from EEPROM
 	shell_boot_script();
 
-	for (;;) {
-		int l_status = wrc_check_link();
-
-		switch (l_status) {
-#ifdef CONFIG_ETHERBONE
-		case LINK_WENT_UP:
-			needIP = 1;
-			break;
-#endif
-
-		case LINK_UP:
-			update_rx_queues();
-#ifdef CONFIG_ETHERBONE
-			ipv4_poll();
-			arp_poll();
-#endif
-			break;
-
-		case LINK_WENT_DOWN:
-			if (wrc_ptp_get_mode() == WRC_MODE_SLAVE) {
-				spll_init(SPLL_MODE_FREE_RUNNING_MASTER, 0, 1);
-				shw_pps_gen_enable_output(0);
-			}
-			break;
-		}
-
-		ui_update();
-		wrc_ptp_update();
-		spll_update_aux_clocks();
-		check_stack();
-	}
+	for (;;)
+		task_run();
 }
@@ -30,6 +30,7 @@ int main(void)
 			{
 //				TRACE("tick!\n");
 				spll_show_stats();
+				rts_loop_stats(tics - start_tics);
 				start_tics = tics;
 			}
 	    rts_update();